@@ -0,0 +1,325 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "eval.hpp"
+#include "generator.hpp"
+#include "lazy_document.hpp"
+#include "lexer.hpp"
+#include "parallel_parser.hpp"
+#include "parser.hpp"
+
+namespace {
+
+std::atomic<std::size_t> allocations{0};
+
+} // namespace
+
+// count the allocations of the whole program
+void *operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto const ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+/** @brief Measurements of one stage. */
+struct Result {
+  std::string name;
+  std::size_t iterations;
+  double seconds_per_iteration;
+  double mb_per_second;
+  double allocations_per_element;
+};
+
+struct Options {
+  Benchmark::GeneratorConfig data;
+  std::size_t operations = 16;
+  std::size_t threads = 4;
+  double min_time = 0.5;
+  std::string out;
+  std::string baseline;
+  double tolerance = 0.1;
+};
+
+/**
+ * @brief Run @p stage until @p min_time seconds have passed, at least once.
+ *
+ * @param bytes Size of the input of the stage.
+ * @param elements Number of elements in the input of the stage.
+ */
+Result run(std::string name, std::function<void()> const &stage,
+           std::size_t bytes, std::size_t elements, double min_time) {
+  using clock = std::chrono::steady_clock;
+  std::size_t iterations = 0;
+  auto const allocations_before = allocations.load();
+  auto const begin = clock::now();
+  std::chrono::duration<double> elapsed{};
+  do {
+    stage();
+    ++iterations;
+    elapsed = clock::now() - begin;
+  } while (elapsed.count() < min_time);
+  auto const seconds = elapsed.count() / static_cast<double>(iterations);
+  auto const allocated = allocations.load() - allocations_before;
+  return {std::move(name), iterations, seconds,
+          static_cast<double>(bytes) / seconds / 1e6,
+          static_cast<double>(allocated) / static_cast<double>(iterations) /
+              static_cast<double>(elements)};
+}
+
+/** @brief Peak resident set size of the process in MB. */
+double peak_rss_mb() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024.0;
+}
+
+std::size_t parse_size(std::string const &str) {
+  std::size_t end = 0;
+  auto size = std::stoull(str, &end);
+  if (end < str.size()) {
+    switch (str[end]) {
+    case 'G':
+      size *= 1024;
+      [[fallthrough]];
+    case 'M':
+      size *= 1024;
+      [[fallthrough]];
+    case 'K':
+      size *= 1024;
+      break;
+    default:
+      throw std::invalid_argument("Invalid size: " + str);
+    }
+  }
+  return static_cast<std::size_t>(size);
+}
+
+[[noreturn]] void usage(char const *name) {
+  std::cout
+      << "Usage: " << name << " [options]\n"
+      << "       " << name
+      << " generate [options] data.xml operations.xml\n\n"
+      << "Options:\n"
+      << "  --size BYTES       size of the data, e.g. 64K, 16M or 1G\n"
+      << "  --depth N          levels of elements below a city\n"
+      << "  --attributes N     attributes per city\n"
+      << "  --content N        digits of the contents\n"
+      << "  --operations N     number of operations\n"
+      << "  --seed N           seed of the generator\n"
+      << "  --threads N        threads of the parallel stages\n"
+      << "  --min-time SECONDS minimal run time of a stage\n"
+      << "  --out FILE         write the results as XML\n"
+      << "  --baseline FILE    compare against results written by --out\n"
+      << "  --tolerance X      allowed relative slowdown, default 0.1\n";
+  std::exit(1);
+}
+
+/** @brief Write @p results in the format read by check_baseline. */
+void write_results(std::vector<Result> const &results, std::ostream &out) {
+  out << "<benchmarks>\n" << std::fixed << std::setprecision(3);
+  for (auto const &r : results) {
+    out << "  <benchmark name=\"" << r.name << "\" mbps=\""
+        << r.mb_per_second << "\" allocs=\"" << r.allocations_per_element
+        << "\"/>\n";
+  }
+  out << "</benchmarks>\n";
+}
+
+/**
+ * @brief Compare @p results with the ones stored in @p path.
+ *
+ * A stage regresses if its throughput dropped by more than @p tolerance or
+ * if it allocates more per element.
+ *
+ * @return Whether no stage regressed.
+ */
+bool check_baseline(std::vector<Result> const &results,
+                    std::string const &path, double tolerance) {
+  std::ifstream stream(path, std::ios::in);
+  if (not stream.is_open())
+    throw std::runtime_error("Cannot open baseline " + path);
+  auto const baseline = XML::Parser(XML::Lexer(stream).tokenize()).parse();
+  bool passed = true;
+  for (auto const elem : baseline) {
+    if (elem->name != "benchmark")
+      continue;
+    auto const name = elem->get_attribute("name");
+    auto const result =
+        std::find_if(results.begin(), results.end(),
+                     [name](auto const &r) { return r.name == name; });
+    if (result == results.end())
+      continue;
+    auto const mbps = std::stod(std::string(elem->get_attribute("mbps")));
+    auto const allocs =
+        std::stod(std::string(elem->get_attribute("allocs")));
+    if (result->mb_per_second < (1.0 - tolerance) * mbps) {
+      std::cout << "REGRESSION " << name << ": " << result->mb_per_second
+                << " MB/s, baseline " << mbps << " MB/s\n";
+      passed = false;
+    }
+    if (result->allocations_per_element > allocs + 0.01) {
+      std::cout << "REGRESSION " << name << ": "
+                << result->allocations_per_element
+                << " allocations per element, baseline " << allocs << "\n";
+      passed = false;
+    }
+  }
+  return passed;
+}
+
+std::vector<Result> run_all(Options const &options) {
+  auto const data = Benchmark::generate_data(options.data);
+  auto const ops = Benchmark::generate_operations(options.operations);
+  auto const operations = Operation::collect_operations(
+      XML::StringParser(XML::StringLexer(ops).tokenize()).parse());
+  // contents with whitespace inside view into the lexer
+  XML::StringLexer lexer(data);
+  auto const tokens = lexer.tokenize();
+  auto const doc = XML::StringParser(tokens).parse();
+  auto const bytes = data.size();
+  auto const elements = doc.size();
+  XML::ThreadPool pool(options.threads);
+  std::ostringstream sink;
+
+  std::cout << "data: " << bytes / 1024 << " KiB, " << elements
+            << " elements, " << operations.size() << " operations, "
+            << options.threads << " threads\n\n";
+
+  std::vector<Result> results;
+  auto const add = [&](std::string name, std::function<void()> const &stage) {
+    results.push_back(
+        run(std::move(name), stage, bytes, elements, options.min_time));
+    auto const &r = results.back();
+    std::cout << std::left << std::setw(18) << r.name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(12)
+              << r.seconds_per_iteration * 1e3 << " ms" << std::setw(8)
+              << r.iterations << std::setprecision(1) << std::setw(10)
+              << r.mb_per_second << " MB/s" << std::setprecision(2)
+              << std::setw(10) << r.allocations_per_element << std::endl;
+  };
+
+  std::cout << std::left << std::setw(18) << "stage" << std::right
+            << std::setw(15) << "time" << std::setw(8) << "iters"
+            << std::setw(15) << "throughput" << std::setw(10)
+            << "allocs/el" << "\n";
+  add("lex_stream", [&]() {
+    std::istringstream stream(data);
+    XML::Lexer(stream).tokenize();
+  });
+  add("lex_string", [&]() { XML::StringLexer(data).tokenize(); });
+  add("parse_tokens", [&]() { XML::StringParser(tokens).parse(); });
+  add("parse_string", [&]() {
+    XML::StringParser(XML::StringLexer(data).tokenize()).parse();
+  });
+  add("parse_parallel", [&]() { XML::parse_parallel(data, pool); });
+  add("parse_lazy", [&]() { XML::LazyDocument{data}; });
+  add("attr_filter", [&]() { XML::attr_filter(doc, "name", "M.*"); });
+  add("extract_columns", [&]() { Operation::Columns(doc, operations); });
+  add("eval_dom", [&]() {
+    sink.str({});
+    Operation::eval(doc, operations, sink);
+  });
+  add("eval_stream", [&]() {
+    sink.str({});
+    Operation::eval(std::string_view(data), ops, sink);
+  });
+  add("eval_lazy", [&]() {
+    sink.str({});
+    Operation::eval(XML::LazyDocument(data), operations, sink);
+  });
+  add("eval_parallel", [&]() {
+    sink.str({});
+    Operation::eval(doc, operations, pool, sink);
+  });
+  add("write_dom", [&]() {
+    sink.str({});
+    sink << doc;
+  });
+  std::cout << "\npeak RSS: " << std::setprecision(1) << peak_rss_mb()
+            << " MB\n";
+  return results;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  bool generate = false;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    auto const value = [&]() -> std::string {
+      if (i + 1 == argc)
+        usage(argv[0]);
+      return argv[++i];
+    };
+    if (arg == "generate" and i == 1)
+      generate = true;
+    else if (arg == "--size")
+      options.data.size = parse_size(value());
+    else if (arg == "--depth")
+      options.data.depth = std::max<std::size_t>(std::stoul(value()), 1);
+    else if (arg == "--attributes")
+      options.data.attributes = std::stoul(value());
+    else if (arg == "--content")
+      options.data.content_length = std::stoul(value());
+    else if (arg == "--operations")
+      options.operations = std::stoul(value());
+    else if (arg == "--seed")
+      options.data.seed = std::stoull(value());
+    else if (arg == "--threads")
+      options.threads = std::stoul(value());
+    else if (arg == "--min-time")
+      options.min_time = std::stod(value());
+    else if (arg == "--out")
+      options.out = value();
+    else if (arg == "--baseline")
+      options.baseline = value();
+    else if (arg == "--tolerance")
+      options.tolerance = std::stod(value());
+    else if (generate and arg.rfind("--", 0) != 0)
+      files.push_back(arg);
+    else
+      usage(argv[0]);
+  }
+
+  if (generate) {
+    if (files.size() != 2)
+      usage(argv[0]);
+    std::ofstream data(files[0], std::ios::out | std::ios::binary);
+    std::ofstream ops(files[1], std::ios::out | std::ios::binary);
+    Benchmark::generate_data(data, options.data);
+    Benchmark::generate_operations(ops, options.operations);
+    return 0;
+  }
+
+  auto const results = run_all(options);
+  if (not options.out.empty()) {
+    std::ofstream out(options.out, std::ios::out);
+    write_results(results, out);
+  }
+  if (not options.baseline.empty() and
+      not check_baseline(results, options.baseline, options.tolerance))
+    return 1;
+  return 0;
+}
@@ -0,0 +1,183 @@
+#ifndef GENERATOR_HPP
+#define GENERATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+/** @file generator.hpp
+ *  @brief This file contains the generators of synthetic benchmark input.
+ */
+
+namespace Benchmark {
+
+/**
+ * @brief Deterministic pseudo random numbers (SplitMix64).
+ *
+ * Unlike the distributions of <random> the sequence is the same on every
+ * platform, so a seed always produces the same documents.
+ */
+class Random {
+public:
+  explicit Random(std::uint64_t seed) : m_state(seed) {}
+
+  std::uint64_t next() {
+    auto z = (m_state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  /** @brief A number in [0, bound). */
+  std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+
+private:
+  std::uint64_t m_state;
+};
+
+/**
+ * @brief Shape of a generated data document.
+ *
+ * The documents look like data/data.xml: a <data> root with <city> elements
+ * that have a name and a population attribute and an <area> child.
+ */
+struct GeneratorConfig {
+  /** Approximate size of the document in bytes. */
+  std::size_t size = 1 << 20;
+  /**
+   * Levels of elements below a city. 1 is the <area> child only, every
+   * further level adds a nested <block> element.
+   */
+  std::size_t depth = 1;
+  /** Attributes of a city, the first two are name and population. */
+  std::size_t attributes = 2;
+  /** Number of digits of the contents. */
+  std::size_t content_length = 6;
+  std::uint64_t seed = 42;
+};
+
+namespace detail {
+
+/**
+ * City names, every filter of the generated operations matches one of the
+ * first eight.
+ */
+constexpr std::array<std::string_view, 16> city_names = {
+    "Stuttgart", "Moskau",  "Washington DC", "Berlin",
+    "Hamburg",   "Mainz",   "Augsburg",      "Bremen",
+    "Dresden",   "Leipzig", "Hannover",      "Nuernberg",
+    "Duisburg",  "Bochum",  "Wuppertal",     "Bielefeld"};
+
+/** @brief Keys of the additional attributes, alphabetic like all names. */
+inline std::string attribute_key(std::size_t index) {
+  std::string key = "attr";
+  do {
+    key += static_cast<char>('a' + index % 26);
+    index /= 26;
+  } while (index != 0);
+  return key;
+}
+
+/** @brief A decimal number with @p digits digits. */
+inline void write_number(std::ostream &output, Random &random,
+                         std::size_t digits) {
+  digits = std::max<std::size_t>(digits, 1);
+  output << static_cast<char>('1' + random.below(9));
+  for (std::size_t i = 1; i < digits; ++i) {
+    if (i == digits - 2)
+      output << '.';
+    output << static_cast<char>('0' + random.below(10));
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Write a data document of the shape @p config to @p output.
+ *
+ * @return The number of elements written.
+ */
+inline std::size_t generate_data(std::ostream &output,
+                                 GeneratorConfig const &config) {
+  Random random(config.seed);
+  std::size_t written = 0;
+  std::size_t elements = 1;
+  std::ostringstream city;
+  output << "<data>\n";
+  for (std::size_t i = 0; written < config.size; ++i) {
+    city.str({});
+    auto const &name = detail::city_names[i % detail::city_names.size()];
+    city << "  <city name=\"" << name << "\" population=\"";
+    detail::write_number(city, random, config.content_length + 2);
+    city << '"';
+    for (std::size_t a = 2; a < config.attributes; ++a) {
+      city << ' ' << detail::attribute_key(a - 2) << "=\"";
+      detail::write_number(city, random, config.content_length);
+      city << '"';
+    }
+    city << ">\n    <area>";
+    detail::write_number(city, random, config.content_length);
+    city << "</area>\n";
+    for (std::size_t level = 1; level < config.depth; ++level) {
+      city << std::string(2 * level + 2, ' ') << "<block>";
+      detail::write_number(city, random, config.content_length);
+      city << '\n';
+    }
+    for (std::size_t level = config.depth - 1; level > 0; --level)
+      city << std::string(2 * level + 2, ' ') << "</block>\n";
+    city << "  </city>\n";
+    auto const str = city.str();
+    output << str;
+    written += str.size();
+    elements += config.depth + 1;
+  }
+  output << "</data>\n";
+  return elements;
+}
+
+/** @brief Generate a data document of the shape @p config as string. */
+inline std::string generate_data(GeneratorConfig const &config) {
+  std::ostringstream output;
+  generate_data(output, config);
+  return output.str();
+}
+
+/**
+ * @brief Write an operations document with @p count operations to @p output.
+ *
+ * The operations cycle through all functions, both types and filters of all
+ * kinds, every one matches some of the generated cities.
+ */
+inline void generate_operations(std::ostream &output, std::size_t count) {
+  constexpr std::array<std::string_view, 8> filters = {
+      "M.*",    ".*burg",    ".*n.+",          ".*e.*n.*",
+      "Berlin", "[A-M].*", "(Ham|Aug)burg", ".*a.*"};
+  constexpr std::array<std::string_view, 4> funcs = {"average", "sum", "min",
+                                                     "max"};
+  output << "<operations>\n";
+  for (std::size_t i = 0; i < count; ++i) {
+    auto const sub = i % 2 == 1;
+    output << "  <operation name=\"op" << i << "\" type=\""
+           << (sub ? "sub" : "attrib") << "\" func=\""
+           << funcs[i % funcs.size()] << "\" attrib=\""
+           << (sub ? "area" : "population") << "\" filter=\""
+           << filters[(i / 2) % filters.size()] << "\"/>\n";
+  }
+  output << "</operations>\n";
+}
+
+/** @brief Generate an operations document as string. */
+inline std::string generate_operations(std::size_t count) {
+  std::ostringstream output;
+  generate_operations(output, count);
+  return output.str();
+}
+
+} // namespace Benchmark
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef ACCUMULATOR_HPP
+#define ACCUMULATOR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "sketches.hpp"
+
+/** @file accumulator.hpp
+ *  @brief This file contains the running state of the aggregate functions.
+ */
+
+namespace Operation {
+
+/** @brief The aggregate functions an operation can apply. */
+enum class Function {
+  min,
+  max,
+  sum,
+  average,
+  count,
+  /** Population variance. */
+  variance,
+  /** Population standard deviation. */
+  stddev,
+  median,
+  p50,
+  p95,
+  p99,
+  /** Approximate number of distinct values. */
+  distinct
+};
+
+/**
+ * @brief The function with name @p name.
+ *
+ * @param name Name \f$\in\f$ {"min", "max", "sum", "average", "count",
+ * "variance", "stddev", "median", "p50", "p95", "p99", "distinct"}.
+ * @throws std::runtime_error If there is no function named @p name.
+ */
+inline Function parse_function(std::string_view name) {
+  constexpr std::pair<std::string_view, Function> functions[] = {
+      {"min", Function::min},           {"max", Function::max},
+      {"sum", Function::sum},           {"average", Function::average},
+      {"count", Function::count},       {"variance", Function::variance},
+      {"stddev", Function::stddev},     {"median", Function::median},
+      {"p50", Function::p50},           {"p95", Function::p95},
+      {"p99", Function::p99},           {"distinct", Function::distinct}};
+  for (auto const &[function_name, function] : functions) {
+    if (name == function_name)
+      return function;
+  }
+  throw std::runtime_error("Unsupported function operation: " +
+                           std::string(name));
+}
+
+/**
+ * @brief Running state of the aggregate functions of an operation.
+ *
+ * Values are folded in one at a time, so no values have to be stored. The
+ * sum is accumulated in the order of the values, which gives the same
+ * result as std::accumulate over all values.
+ *
+ * Count, sum, minimum and maximum are always kept. The state the other
+ * functions need, e.g. a quantile sketch, is only kept by accumulators made
+ * for them with for_function. All states are small and mergeable.
+ */
+struct Accumulator {
+  /** State beyond count, sum, minimum and maximum. */
+  using Extra =
+      std::variant<std::monostate, Moments, QuantileSketch, DistinctCounter>;
+
+  std::size_t count = 0;
+  double sum = 0.0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  Extra extra;
+
+  /** @brief An empty accumulator keeping the state @p func needs. */
+  static Accumulator for_function(Function func) {
+    Accumulator state;
+    switch (func) {
+    case Function::variance:
+    case Function::stddev:
+      state.extra = Moments{};
+      break;
+    case Function::median:
+    case Function::p50:
+    case Function::p95:
+    case Function::p99:
+      state.extra = QuantileSketch{};
+      break;
+    case Function::distinct:
+      state.extra = DistinctCounter{};
+      break;
+    default:
+      break;
+    }
+    return state;
+  }
+
+  /** @brief Fold @p value into the state. */
+  void add(double value) {
+    ++count;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    if (extra.index() != 0)
+      std::visit(
+          [value](auto &state) {
+            if constexpr (not std::is_same_v<std::decay_t<decltype(state)>,
+                                             std::monostate>)
+              state.add(value);
+          },
+          extra);
+  }
+
+  /**
+   * @brief Fold the state of @p other into this state.
+   *
+   * Merging the states of consecutive ranges of values gives the state of
+   * the whole range, up to the rounding of the sum and the estimates of the
+   * sketches. An accumulator without extra state takes the one of @p other.
+   */
+  void merge(Accumulator const &other) {
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    if (extra.index() == 0) {
+      extra = other.extra;
+    } else if (extra.index() == other.extra.index()) {
+      std::visit(
+          [&other](auto &state) {
+            using T = std::decay_t<decltype(state)>;
+            if constexpr (not std::is_same_v<T, std::monostate>)
+              state.merge(std::get<T>(other.extra));
+          },
+          extra);
+    }
+  }
+
+  /**
+   * @brief The value of the function @p func.
+   *
+   * @throws std::runtime_error If the state @p func needs is not kept.
+   */
+  double result(Function func) const {
+    switch (func) {
+    case Function::min:
+      return min;
+    case Function::max:
+      return max;
+    case Function::sum:
+      return sum;
+    case Function::average:
+      return sum / static_cast<double>(count);
+    case Function::count:
+      return static_cast<double>(count);
+    case Function::variance:
+      return get<Moments>().variance();
+    case Function::stddev:
+      return std::sqrt(get<Moments>().variance());
+    case Function::median:
+    case Function::p50:
+      return get<QuantileSketch>().quantile(0.5);
+    case Function::p95:
+      return get<QuantileSketch>().quantile(0.95);
+    case Function::p99:
+      return get<QuantileSketch>().quantile(0.99);
+    case Function::distinct:
+      return std::round(get<DistinctCounter>().estimate());
+    }
+    return sum;
+  }
+
+  /**
+   * @brief The value of the function with name @p name.
+   *
+   * @see parse_function
+   */
+  double result(std::string_view name) const {
+    return result(parse_function(name));
+  }
+
+  /**
+   * @brief The extra state as a single word, "-" if there is none.
+   *
+   * The word starts with a letter naming the kind of state, followed by the
+   * encoding of the state.
+   */
+  std::string encode_extra() const {
+    if (auto const moments = std::get_if<Moments>(&extra))
+      return "m" + moments->encode();
+    if (auto const sketch = std::get_if<QuantileSketch>(&extra))
+      return "q" + sketch->encode();
+    if (auto const counter = std::get_if<DistinctCounter>(&extra))
+      return "d" + counter->encode();
+    return "-";
+  }
+
+  /**
+   * @brief Read the extra state written by encode_extra.
+   *
+   * @return Whether @p word could be read.
+   */
+  bool decode_extra(std::string_view word) {
+    if (word == "-") {
+      extra = std::monostate{};
+      return true;
+    }
+    if (word.empty())
+      return false;
+    auto const kind = word.front();
+    word.remove_prefix(1);
+    auto const decode = [this, word](auto state) {
+      if (not state.decode(word))
+        return false;
+      extra = std::move(state);
+      return true;
+    };
+    if (kind == 'm')
+      return decode(Moments{});
+    if (kind == 'q')
+      return decode(QuantileSketch{});
+    if (kind == 'd')
+      return decode(DistinctCounter{});
+    return false;
+  }
+
+private:
+  template <class State> State const &get() const {
+    if (auto const state = std::get_if<State>(&extra))
+      return *state;
+    throw std::runtime_error("State of the function is not kept");
+  }
+};
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef COLUMNS_HPP
+#define COLUMNS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "filter.hpp"
+#include "number.hpp"
+#include "operation.hpp"
+#include "parser.hpp"
+#include "reduction.hpp"
+#include "stats.hpp"
+
+/** @file columns.hpp
+ *  @brief This file contains the columnar extraction of the data fields.
+ */
+
+namespace Operation {
+
+/**
+ * @brief The fields of a document that operations read, as columns.
+ *
+ * Every column has one row per element of the document, in document order.
+ * The key column holds the value of the attribute the filters apply to,
+ * dictionary encoded, so a filter is run once per distinct key. Every value
+ * column holds the numbers of one attribute or child content.
+ * Operations reading the same field share its column. The document is
+ * walked once to fill all columns, afterwards filters and aggregates run
+ * over contiguous arrays instead of the linked elements.
+ */
+class Columns {
+public:
+  /** Name of the attribute the filters of the operations apply to. */
+  static constexpr std::string_view key_attribute = "name";
+
+  /**
+   * @brief Extract the fields @p operations read from @p doc.
+   *
+   * Values that are missing or no numbers do not raise an error here, see
+   * require_values.
+   *
+   * @param doc The parsed data document, it has to outlive the columns.
+   * @param operations The operations whose fields are extracted.
+   * @throws std::runtime_error If an operation has an unsupported type.
+   */
+  Columns(XML::XML_Doc const &doc, std::vector<Operation> const &operations)
+      : m_doc(doc) {
+    for (auto const &op : operations) {
+      if (op.m_type != "sub" and op.m_type != "attrib")
+        throw std::runtime_error("Unsuported operation type");
+      Field const field{op.m_type == "sub", op.m_attrib};
+      auto const it = std::find(m_fields.begin(), m_fields.end(), field);
+      m_column_index.push_back(
+          static_cast<std::size_t>(std::distance(m_fields.begin(), it)));
+      if (it == m_fields.end())
+        m_fields.push_back(field);
+    }
+    extract();
+  }
+
+  /** @brief Number of rows, i.e. elements of the document. */
+  std::size_t size() const { return m_keys.size(); }
+
+  /** @brief The value of the key attribute of the element in @p row. */
+  std::string_view key(std::size_t row) const {
+    return m_dictionary[m_keys[row]];
+  }
+
+  /** @brief Number of distinct keys. */
+  std::size_t distinct_keys() const { return m_dictionary.size(); }
+
+  /** @brief Number of value columns, i.e. distinct fields. */
+  std::size_t columns() const { return m_values.size(); }
+
+  /** @brief The value column the operation with index @p op reads. */
+  std::size_t column_index(std::size_t op) const { return m_column_index[op]; }
+
+  /**
+   * @brief The numbers of the value column @p column.
+   *
+   * Rows whose value could not be extracted hold NaN.
+   */
+  std::vector<double> const &values(std::size_t column) const {
+    return m_values[column];
+  }
+
+  /** @brief The rows whose key matches @p filter, ascending. */
+  std::vector<std::size_t> select(XML::Filter const &filter) const {
+    YAXP_STATS_TIMER(filter);
+    YAXP_STATS_COUNT(filter_evaluations, m_dictionary.size());
+    std::vector<char> matches(m_dictionary.size());
+    for (std::size_t k = 0; k < m_dictionary.size(); ++k)
+      matches[k] = filter(m_dictionary[k]);
+    std::vector<std::size_t> rows;
+    for (std::size_t row = 0; row < m_keys.size(); ++row) {
+      if (matches[m_keys[row]])
+        rows.push_back(row);
+    }
+    return rows;
+  }
+
+  /**
+   * @brief Raise the error of the first of @p rows whose value in
+   * @p column could not be extracted.
+   *
+   * The errors are the ones of reading the value from the element, so
+   * elements that no operation selects may lack the field. Only the rows
+   * holding NaN are read again.
+   *
+   * @param column The value column.
+   * @param rows The rows to check, e.g. from select.
+   * @throws std::runtime_error If a child is missing.
+   * @throws std::invalid_argument If a value is no number.
+   * @throws std::out_of_range If a value is out of range.
+   */
+  void require_values(std::size_t column,
+                      std::vector<std::size_t> const &rows) const {
+    auto const &values = m_values[column];
+    for (auto const row : rows) {
+      if (std::isnan(values[row]))
+        to_double(read(m_fields[column], *m_doc[row]));
+    }
+  }
+
+private:
+  /** A field operations read: a child content or an attribute. */
+  struct Field {
+    bool sub;
+    std::string_view name;
+    XML::Symbol symbol = XML::no_symbol;
+
+    bool operator==(Field const &other) const {
+      return sub == other.sub and name == other.name;
+    }
+  };
+
+  /**
+   * @brief The value of @p field of @p elem.
+   * @throws std::runtime_error If the child is missing.
+   */
+  static std::string_view read(Field const &field,
+                               XML::XML_Element const &elem) {
+    if (not field.sub)
+      return elem.get_attribute(field.symbol);
+    auto const child = elem.find_child(field.symbol);
+    if (child == nullptr)
+      throw std::runtime_error("Child not found");
+    return child->content;
+  }
+
+  /** @brief Fill the key and value columns in a single walk. */
+  void extract() {
+    YAXP_STATS_TIMER(convert);
+    auto const key = m_doc.m_symbols->find(key_attribute);
+    for (auto &field : m_fields)
+      field.symbol = m_doc.m_symbols->find(field.name);
+    m_keys.reserve(m_doc.size());
+    std::unordered_map<std::string_view, std::uint32_t> ids;
+    m_values.resize(m_fields.size());
+    for (auto &values : m_values)
+      values.reserve(m_doc.size());
+    for (auto const e : m_doc) {
+      auto const id = ids.try_emplace(e->get_attribute(key),
+                                      static_cast<std::uint32_t>(ids.size()));
+      if (id.second)
+        m_dictionary.push_back(id.first->first);
+      m_keys.push_back(id.first->second);
+      for (std::size_t c = 0; c < m_fields.size(); ++c) {
+        auto const &field = m_fields[c];
+        std::optional<double> value;
+        if (not field.sub) {
+          value = parse_number(e->get_attribute(field.symbol));
+        } else if (auto const child = e->find_child(field.symbol)) {
+          value = parse_number(child->content);
+        }
+        YAXP_STATS_COUNT(conversions, 1);
+        m_values[c].push_back(
+            value ? *value : std::numeric_limits<double>::quiet_NaN());
+      }
+    }
+  }
+
+  XML::XML_Doc const &m_doc;
+  std::vector<Field> m_fields;
+  /** Index of the field of each operation. */
+  std::vector<std::size_t> m_column_index;
+  /** The index of the key of every row in m_dictionary. */
+  std::vector<std::uint32_t> m_keys;
+  /** The distinct keys. */
+  std::vector<std::string_view> m_dictionary;
+  std::vector<std::vector<double>> m_values;
+};
+
+/**
+ * @brief Reduce the numbers of @p values in @p rows into the state of
+ * @p func.
+ *
+ * If @p func only needs count, sum, minimum and maximum, the numbers are
+ * gathered into a contiguous array that is reduced by the vectorized
+ * kernels, see reduce. The sum is added pairwise, so it may differ in the
+ * last bits from folding the elements one at a time. The numbers are
+ * folded into the sketches of the other functions one at a time.
+ */
+inline Accumulator aggregate(std::vector<double> const &values,
+                             std::vector<std::size_t> const &rows,
+                             Function func) {
+  auto state = Accumulator::for_function(func);
+  if (state.extra.index() != 0) {
+    for (auto const row : rows)
+      state.add(values[row]);
+    return state;
+  }
+  if (rows.size() == values.size())
+    return reduce(values);
+  std::vector<double> selected(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i)
+    selected[i] = values[rows[i]];
+  return reduce(selected);
+}
+
+} // namespace Operation
+
+#endif
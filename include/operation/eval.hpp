@@ -2,86 +2,1114 @@
 #define EVAL_HPP
 
 #include <algorithm>
-#include <iomanip>
+#include <cmath>
+#include <future>
+#include <memory>
 #include <istream>
 #include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "accumulator.hpp"
+#include "binary_document.hpp"
+#include "columns.hpp"
+#include "groups.hpp"
+#include "lazy_document.hpp"
+#include "number.hpp"
 #include "operation.hpp"
 #include "output.hpp"
 #include "parser.hpp"
+#include "path.hpp"
+#include "reader.hpp"
+#include "reduction.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include "writer.hpp"
 
 namespace Operation {
 
+/**
+ * @brief Apply the function @p func on the data.
+ *
+ * @param func The function to apply on @p data.
+ * @param data Data to operate on.
+ * @return The return value of @p func applied on the @p data.
+ */
+inline double apply_func(Function func, std::vector<double> const &data) {
+  auto state = Accumulator::for_function(func);
+  if (state.extra.index() == 0)
+    return reduce(data).result(func);
+  for (auto const value : data)
+    state.add(value);
+  return state.result(func);
+}
+
 /**
  * @brief Map the function name given as a string to the resp. function and
  * apply it on the data.
  *
  * @param name The name of a function to apply on @p data. Name \f$\in\f$
- * {"min", "max", "sum", "average"}.
+ * {"min", "max", "sum", "average", "count", "variance", "stddev", "median",
+ * "p50", "p95", "p99", "distinct"}.
  * @param data Data to operate on.
  * @return The return value of the function with name @p name applied on the @p
  * data.
  */
-double apply_func(std::string name, std::vector<double> const &data) {
-  if (name == "min")
-    return *std::min_element(data.begin(), data.end());
-  if (name == "max")
-    return *std::max_element(data.begin(), data.end());
-  if (name == "sum")
-    return std::accumulate(data.begin(), data.end(), 0.0);
-  if (name == "average")
-    return apply_func("sum", data) / data.size();
-  throw std::runtime_error("Unsupported function operation: " + name);
+double apply_func(std::string const &name, std::vector<double> const &data) {
+  return apply_func(parse_function(name), data);
 }
 
-void eval(std::istream &data, std::istream &ops, std::ostream &output) {
-  auto const data_doc = XML::Parser(XML::Lexer(data).tokenize()).parse();
-  auto const op_doc = XML::Parser(XML::Lexer(ops).tokenize()).parse();
-
-  // collect all operations
+/**
+ * @brief Collect all operations of a parsed operations document.
+ *
+ * @param op_doc The parsed operations document.
+ * @return The operations in document order.
+ */
+std::vector<Operation> collect_operations(XML::XML_Doc const &op_doc) {
   std::vector<Operation> operations;
   for (auto const e : op_doc) {
     if (e->name == "operation")
       operations.emplace_back(Operation(*e));
   }
   assert(not operations.empty());
+  return operations;
+}
 
-  XML::XML_Doc results;
-  auto const root = std::make_shared<XML::XML_Element>("results", nullptr, 0);
-  results.add_element(root);
-  for (auto const &op : operations) {
-    // filter elements
-    auto const elements = XML::attr_filter(data_doc, "name", op.m_filter);
-    // gather values
-    std::vector<double> values;
-    for (auto e : elements) {
-      if (op.m_type == "sub") {
-        auto const val = std::stod(e->get_child(op.m_attrib).content);
-        values.push_back(val);
+namespace detail {
+
+/**
+ * @brief The parts of an open element that operations can refer to.
+ *
+ * Of the children only the content of the first child with a given name is
+ * kept, which is what XML::XML_Element::get_child returns. The symbols of the
+ * names are set if the lexer interns names, otherwise they are
+ * XML::no_symbol.
+ */
+template <class String> struct ElementFrame {
+  std::vector<std::pair<String, String>> attributes;
+  std::vector<XML::Symbol> attribute_symbols;
+  String content;
+  std::vector<std::pair<String, String>> children;
+  std::vector<XML::Symbol> child_symbols;
+
+  void clear() {
+    attributes.clear();
+    attribute_symbols.clear();
+    content = {};
+    children.clear();
+    child_symbols.clear();
+  }
+
+  String get_attribute(std::string_view attr_name) const {
+    for (auto const &attr : attributes) {
+      if (attr.first == attr_name)
+        return attr.second;
+    }
+    return {};
+  }
+
+  String get_attribute(XML::Symbol key) const {
+    for (std::size_t i = 0; i < attributes.size(); ++i) {
+      if (attribute_symbols[i] == key)
+        return attributes[i].second;
+    }
+    return {};
+  }
+
+  String const &get_child_content(std::string_view child_name) const {
+    for (auto const &child : children) {
+      if (child.first == child_name)
+        return child.second;
+    }
+    throw std::runtime_error("Child not found");
+  }
+
+  String const &get_child_content(XML::Symbol child_name) const {
+    for (std::size_t i = 0; i < children.size(); ++i) {
+      if (child_symbols[i] == child_name)
+        return children[i].second;
+    }
+    throw std::runtime_error("Child not found");
+  }
+
+  void add_child(String name, XML::Symbol symbol, String child_content) {
+    for (auto const &child : children) {
+      if (child.first == name)
+        return;
+    }
+    children.emplace_back(std::move(name), std::move(child_content));
+    child_symbols.push_back(symbol);
+  }
+};
+
+/** @brief The content of the first child of @p elem named @p name. */
+inline std::string_view get_child_content(XML::XML_Element const &elem,
+                                          std::string_view name) {
+  return elem.get_child(name).content;
+}
+
+/** @copydoc get_child_content */
+inline std::string_view get_child_content(XML::XML_Element const &elem,
+                                          XML::Symbol name) {
+  auto const child = elem.find_child(name);
+  if (child == nullptr)
+    throw std::runtime_error("Child not found");
+  return child->content;
+}
+
+/** @copydoc get_child_content */
+template <class Key>
+std::string_view get_child_content(XML::BinaryElement const &elem, Key name) {
+  return elem.get_child(name).content();
+}
+
+/** @copydoc get_child_content */
+inline std::string_view get_child_content(XML::LazyElement const &elem,
+                                          std::string_view name) {
+  return elem.get_child(name).content();
+}
+
+/** @copydoc get_child_content */
+template <class String, class Key>
+String const &get_child_content(ElementFrame<String> const &elem, Key name) {
+  return elem.get_child_content(name);
+}
+
+/**
+ * @brief A lazy element whose attributes were decoded in one scan, see
+ * XML::LazyElement::get_attributes.
+ *
+ * Attributes and children are looked up by their slot in the names.
+ */
+struct DecodedElement {
+  XML::LazyElement const &elem;
+  std::vector<std::string_view> const &names;
+  std::vector<std::string_view> const &values;
+
+  std::string_view get_attribute(std::size_t slot) const {
+    return values[slot];
+  }
+};
+
+/** @copydoc get_child_content */
+inline std::string_view get_child_content(DecodedElement const &elem,
+                                          std::size_t slot) {
+  return get_child_content(elem.elem, elem.names[slot]);
+}
+
+/** @brief Whether the attributes of @p Element can be looked up by symbol. */
+template <class Element, class = void>
+struct has_symbol_lookup : std::false_type {};
+
+template <class Element>
+struct has_symbol_lookup<
+    Element, std::void_t<decltype(std::declval<Element const &>().get_attribute(
+                 std::declval<XML::Symbol>()))>> : std::true_type {};
+
+} // namespace detail
+
+/**
+ * @brief Single pass evaluation engine for a set of operations.
+ *
+ * Every processed element is tested against the filters of all operations
+ * and the values of the matching ones are folded into the accumulators of
+ * the operations right away. Operations with the same filter share its
+ * evaluation. Grouped operations also fold the values into the state of the
+ * group of the element, see Groups.
+ *
+ * The values of operations of type "path" depend on the ancestors of the
+ * elements. They are selected by a PathMatcher per distinct path, which
+ * needs every element entered before its children and left after them, see
+ * enter and leave.
+ */
+class Evaluator {
+public:
+  /** Name of the attribute the filters of the operations apply to. */
+  static constexpr std::string_view filter_attribute = "name";
+
+  /**
+   * @brief Constructor of the evaluator.
+   *
+   * @param operations The operations to evaluate.
+   * @throws std::runtime_error If an operation has an unsupported type.
+   */
+  explicit Evaluator(std::vector<Operation> operations)
+      : m_operations(std::move(operations)) {
+    std::vector<std::string_view> patterns;
+    for (std::size_t i = 0; i < m_operations.size(); ++i) {
+      auto const &op = m_operations[i];
+      m_accumulators.push_back(Accumulator::for_function(op.m_function));
+      m_groups.emplace_back(op.m_function,
+                            op.m_group.empty() ? 0 : op.m_group_limit);
+      m_group_attribs.push_back(op.m_group);
+      if (op.m_compiled_path) {
+        auto const path = std::find_if(
+            m_paths.begin(), m_paths.end(), [&op](auto const &matcher) {
+              return matcher.path().expression() == op.m_attrib;
+            });
+        m_path_ops.emplace_back(
+            i,
+            static_cast<std::size_t>(std::distance(m_paths.begin(), path)));
+        if (path == m_paths.end())
+          m_paths.emplace_back(*op.m_compiled_path);
+        // not read, path operations are not folded by process
+        m_source_index.push_back(0);
+        m_filter_index.push_back(0);
+        continue;
+      }
+      if (op.m_type != "sub" and op.m_type != "attrib")
+        throw std::runtime_error("Unsuported operation type");
+      m_row_ops.push_back(i);
+      auto const sub = op.m_type == "sub";
+      auto const source = std::find_if(
+          m_sources.begin(), m_sources.end(), [&op, sub](auto const &s) {
+            return s.sub == sub and s.attrib == op.m_attrib;
+          });
+      m_source_index.push_back(
+          static_cast<std::size_t>(std::distance(m_sources.begin(), source)));
+      if (source == m_sources.end())
+        m_sources.push_back({sub, op.m_attrib});
+      auto const it = std::find(patterns.begin(), patterns.end(), op.m_filter);
+      m_filter_index.push_back(
+          static_cast<std::size_t>(std::distance(patterns.begin(), it)));
+      if (it == patterns.end()) {
+        patterns.push_back(op.m_filter);
+        m_filters.push_back(op.m_compiled_filter);
+      }
+    }
+    m_matches.resize(m_filters.size());
+    for (auto const &source : m_sources)
+      m_attribs.push_back(source.attrib);
+    m_values.resize(m_sources.size());
+    m_parsed_at.resize(m_sources.size(), 0);
+    // the slots of the lazily decoded names: sources, filter and groups
+    m_lazy_names = m_attribs;
+    for (std::size_t s = 0; s < m_sources.size(); ++s)
+      m_attrib_slots.push_back(s);
+    m_filter_slot = m_lazy_names.size();
+    m_lazy_names.push_back(filter_attribute);
+    for (auto const group : m_group_attribs) {
+      m_group_slots.push_back(m_lazy_names.size());
+      m_lazy_names.push_back(group);
+    }
+  }
+
+  // the views in m_sources refer to the strings of m_operations
+  Evaluator(Evaluator const &) = delete;
+  Evaluator &operator=(Evaluator const &) = delete;
+
+  /**
+   * @brief Look up the attributes and children of the processed elements
+   * by their symbols in @p symbols.
+   *
+   * Names that are not in @p symbols do not occur in the processed elements.
+   *
+   * @param symbols The table all processed elements use.
+   */
+  void use_symbols(XML::SymbolTable const &symbols) {
+    m_use_symbols = true;
+    m_filter_symbol = symbols.find(filter_attribute);
+    m_attrib_symbols.clear();
+    for (auto const &source : m_sources)
+      m_attrib_symbols.push_back(symbols.find(source.attrib));
+    m_group_symbols.clear();
+    for (auto const group : m_group_attribs)
+      m_group_symbols.push_back(symbols.find(group));
+  }
+
+  /**
+   * @brief Intern the names the operations refer to in @p symbols and look
+   * them up by their symbols, e.g. before the elements are lexed.
+   *
+   * @param symbols The table all processed elements use.
+   */
+  void intern_symbols(XML::SymbolTable &symbols) {
+    symbols.intern(filter_attribute);
+    for (auto const &op : m_operations) {
+      if (not op.m_compiled_path)
+        symbols.intern(op.m_attrib);
+      if (not op.m_group.empty())
+        symbols.intern(op.m_group);
+    }
+    use_symbols(symbols);
+  }
+
+  /**
+   * @brief Fold the values of @p elem into the operations it matches.
+   *
+   * @param elem A XML::XML_Element, XML::LazyElement, XML::BinaryElement or
+   * a streamed element.
+   */
+  template <class Element> void process(Element const &elem) {
+    if constexpr (std::is_same_v<Element, XML::LazyElement>) {
+      // a single scan of the start tag decodes all attributes fold reads
+      elem.get_attributes(m_lazy_names, m_lazy_values);
+      return fold(detail::DecodedElement{elem, m_lazy_names, m_lazy_values},
+                  m_filter_slot, m_attrib_slots, m_group_slots);
+    } else if constexpr (detail::has_symbol_lookup<Element>::value) {
+      if (m_use_symbols)
+        return fold(elem, m_filter_symbol, m_attrib_symbols, m_group_symbols);
+    }
+    fold(elem, filter_attribute, m_attribs, m_group_attribs);
+  }
+
+  std::vector<Operation> const &operations() const { return m_operations; }
+
+  std::vector<Accumulator> const &accumulators() const {
+    return m_accumulators;
+  }
+
+  /** @brief The groups of each operation, empty if it is not grouped. */
+  std::vector<Groups> const &groups() const { return m_groups; }
+
+  /** @brief Whether operations select their values by paths. */
+  bool has_paths() const { return not m_paths.empty(); }
+
+  /**
+   * @brief Enter @p elem, whose attributes are complete, before its
+   * children.
+   *
+   * The attributes that paths select are folded right away.
+   *
+   * @param elem The element, like for process.
+   * @param name The name of @p elem.
+   */
+  template <class Element>
+  void enter(Element const &elem, std::string_view name) {
+    for (std::size_t k = 0; k < m_paths.size(); ++k) {
+      auto const &attribute = m_paths[k].path().attribute();
+      if (not m_paths[k].enter(elem, name) or attribute.empty())
+        continue;
+      auto const &value = elem.get_attribute(std::string_view(attribute));
+      // in contrast to "attrib" operations, missing attributes are skipped
+      if (not value.empty())
+        fold_path(k, elem, value);
+    }
+  }
+
+  /**
+   * @brief Leave @p elem after its children, the contents that paths
+   * select are folded.
+   */
+  template <class Element> void leave(Element const &elem) {
+    for (std::size_t k = 0; k < m_paths.size(); ++k) {
+      if (m_paths[k].selected() and m_paths[k].path().attribute().empty())
+        fold_path(k, elem, elem.content);
+      m_paths[k].leave();
+    }
+  }
+
+  /**
+   * @brief Continue from the states of an earlier evaluation.
+   *
+   * Folding the remaining elements gives the same states as folding all
+   * elements, including the rounding of the sums.
+   *
+   * @param accumulators The states of the operations, in their order.
+   * @throws std::runtime_error If the number of states does not match.
+   */
+  void resume(std::vector<Accumulator> accumulators) {
+    if (accumulators.size() != m_operations.size())
+      throw std::runtime_error("Number of states does not match");
+    m_accumulators = std::move(accumulators);
+  }
+
+private:
+  /** The value an operation reads: a child or an attribute. */
+  struct Source {
+    bool sub;
+    std::string_view attrib;
+  };
+
+  /**
+   * @brief Fold the values of @p elem into the operations it matches.
+   *
+   * The value of a source is parsed once per element and only if a matching
+   * operation reads it.
+   *
+   * @param filter_key Key of the attribute the filters apply to.
+   * @param attribs The attribute or child name of each source.
+   * @param groups The attribute each operation is grouped by.
+   */
+  template <class Element, class Key>
+  void fold(Element const &elem, Key filter_key,
+            std::vector<Key> const &attribs, std::vector<Key> const &groups) {
+    {
+      YAXP_STATS_TIMER(filter);
+      YAXP_STATS_COUNT(filter_evaluations, m_filters.size());
+      auto const &filter_value = elem.get_attribute(filter_key);
+      for (std::size_t i = 0; i < m_filters.size(); ++i)
+        m_matches[i] = m_filters[i](filter_value);
+    }
+    ++m_element;
+    for (auto const i : m_row_ops) {
+      if (not m_matches[m_filter_index[i]])
         continue;
+      auto const s = m_source_index[i];
+      if (m_parsed_at[s] != m_element) {
+        YAXP_STATS_TIMER(convert);
+        YAXP_STATS_COUNT(conversions, 1);
+        auto const &val_str =
+            m_sources[s].sub ? detail::get_child_content(elem, attribs[s])
+                             : elem.get_attribute(attribs[s]);
+        m_values[s] = to_double(val_str);
+        m_parsed_at[s] = m_element;
       }
-      if (op.m_type == "attrib") {
-        auto const val = std::stod(e->get_attribute(op.m_attrib));
-        values.push_back(val);
+      m_accumulators[i].add(m_values[s]);
+      if (not m_operations[i].m_group.empty())
+        m_groups[i][elem.get_attribute(groups[i])].add(m_values[s]);
+    }
+  }
+
+  /**
+   * @brief Fold @p value, selected in @p elem by the path @p path, into the
+   * operations reading the path whose filter @p elem matches.
+   */
+  template <class Element, class String>
+  void fold_path(std::size_t path, Element const &elem, String const &value) {
+    auto const &filter_value = elem.get_attribute(filter_attribute);
+    std::optional<double> number;
+    for (auto const &[i, k] : m_path_ops) {
+      auto const &op = m_operations[i];
+      if (k != path or not op.m_compiled_filter(filter_value))
         continue;
+      if (not number) {
+        YAXP_STATS_COUNT(conversions, 1);
+        number = to_double(value);
       }
-      throw std::runtime_error("Unsuported operation type");
+      m_accumulators[i].add(*number);
+      if (not op.m_group.empty())
+        m_groups[i][elem.get_attribute(std::string_view(op.m_group))].add(
+            *number);
+    }
+  }
+
+  std::vector<Operation> m_operations;
+  /** The operations of type "sub" and "attrib". */
+  std::vector<std::size_t> m_row_ops;
+  /** The distinct paths of the path operations. */
+  std::vector<PathMatcher> m_paths;
+  /** Index and path of each path operation. */
+  std::vector<std::pair<std::size_t, std::size_t>> m_path_ops;
+  /** The distinct values the operations read. */
+  std::vector<Source> m_sources;
+  /** Index of the source of each operation. */
+  std::vector<std::size_t> m_source_index;
+  /** The attribute or child name of each source. */
+  std::vector<std::string_view> m_attribs;
+  /** The values of the current element, valid if parsed at m_element. */
+  std::vector<double> m_values;
+  std::vector<std::size_t> m_parsed_at;
+  /** Number of processed elements. */
+  std::size_t m_element = 0;
+  /** Whether the lookups use the symbols of the names. */
+  bool m_use_symbols = false;
+  XML::Symbol m_filter_symbol = XML::no_symbol;
+  std::vector<XML::Symbol> m_attrib_symbols;
+  /** The distinct filters of the operations. */
+  std::vector<XML::Filter> m_filters;
+  /** Index of the filter of each operation. */
+  std::vector<std::size_t> m_filter_index;
+  /** Whether the current element matches the filters. */
+  std::vector<char> m_matches;
+  std::vector<Accumulator> m_accumulators;
+  std::vector<Groups> m_groups;
+  /** The attribute each operation is grouped by. */
+  std::vector<std::string_view> m_group_attribs;
+  std::vector<XML::Symbol> m_group_symbols;
+  /** The names a lazy element is decoded for, looked up by slot. */
+  std::vector<std::string_view> m_lazy_names;
+  /** The decoded attributes of the current lazy element. */
+  std::vector<std::string_view> m_lazy_values;
+  std::size_t m_filter_slot = 0;
+  std::vector<std::size_t> m_attrib_slots;
+  std::vector<std::size_t> m_group_slots;
+};
+
+namespace detail {
+
+/**
+ * @brief Pass the elements of @p doc to @p evaluator in a walk of the tree.
+ *
+ * Every element is entered before and processed and left after its
+ * children, so the elements are processed in the same order as they are
+ * stored in @p doc. The tree is walked with an explicit stack, like by
+ * XML::Writer.
+ */
+inline void walk(XML::XML_Doc const &doc, Evaluator &evaluator) {
+  if (doc.size() == 0)
+    return;
+  // the open elements and their next child
+  std::vector<std::pair<XML::XML_Element const *, XML::XML_Element const *>>
+      stack;
+  auto const enter = [&](XML::XML_Element const &elem) {
+    evaluator.enter(elem, elem.name);
+    stack.emplace_back(&elem, elem.first_child);
+  };
+  enter(*doc.back());
+  while (not stack.empty()) {
+    auto &top = stack.back();
+    if (auto const child = top.second) {
+      top.second = child->next_sibling;
+      enter(*child);
+      continue;
     }
-    assert(not values.empty());
+    evaluator.process(*top.first);
+    evaluator.leave(*top.first);
+    stack.pop_back();
+  }
+}
 
-    auto res_elem = std::make_shared<XML::XML_Element>("result", root, 1);
-    res_elem->attributes.push_back(
-        XML::XML_Attribute{std::make_pair("name", op.m_name)});
-    std::ostringstream res_s;
-    res_s << std::fixed << std::setprecision(2)
-          << apply_func(op.m_func, values);
+} // namespace detail
 
-    res_elem->content = res_s.str();
-    root->children.push_back(res_elem);
+/**
+ * @brief The fields of the data the @p operations read.
+ *
+ * These are the attribute the filters apply to, the attributes of the
+ * "attrib" operations, the attributes the operations are grouped by and the
+ * contents of the children of the "sub" operations. Of the paths, the
+ * attributes their predicates test and the attributes or contents they
+ * select are read. Lexing the data with this projection skips everything
+ * else.
+ *
+ * @return The projection or nullptr if the contents of all elements are
+ * read, i.e. a path selects the contents of any element by "*".
+ */
+inline std::shared_ptr<XML::Projection const>
+make_projection(std::vector<Operation> const &operations) {
+  auto projection = std::make_shared<XML::Projection>();
+  projection->add_attribute(Evaluator::filter_attribute);
+  for (auto const &op : operations) {
+    if (op.m_compiled_path) {
+      auto const &path = *op.m_compiled_path;
+      for (auto const &step : path.steps()) {
+        for (auto const &predicate : step.predicates)
+          projection->add_attribute(predicate.attribute);
+      }
+      if (not path.attribute().empty())
+        projection->add_attribute(path.attribute());
+      else if (path.steps().back().name == "*")
+        return nullptr;
+      else
+        projection->add_content(path.steps().back().name);
+    } else if (op.m_type == "sub")
+      projection->add_content(op.m_attrib);
+    else
+      projection->add_attribute(op.m_attrib);
+    if (not op.m_group.empty())
+      projection->add_attribute(op.m_group);
   }
-  output << results;
+  return projection;
+}
+
+/**
+ * @brief Write the results of the operations as XML document.
+ *
+ * A grouped operation has one result per group, in the order the groups
+ * first occur. Its group attribute holds the key of the group.
+ *
+ * @param operations The evaluated operations.
+ * @param accumulators The final state of each operation.
+ * @param output Stream to write the resulting XML document to.
+ * @param groups The final groups of each operation, may be empty if no
+ * operation is grouped.
+ */
+void write_results(std::vector<Operation> const &operations,
+                   std::vector<Accumulator> const &accumulators,
+                   std::ostream &output,
+                   std::vector<Groups> const &groups = {}) {
+  assert(operations.size() == accumulators.size());
+  YAXP_STATS_TIMER(output);
+#ifdef YAXP_STATS
+  for (std::size_t i = 0; i < operations.size(); ++i)
+    XML::Stats::instance().add_matches(operations[i].m_name,
+                                       accumulators[i].count);
+#endif
+  XML::Writer writer(output);
+  auto const write = [&writer](Operation const &op, Accumulator const &acc,
+                               std::optional<std::string_view> group) {
+    writer.start_element("result", 1);
+    writer.attribute("name", op.m_name);
+    if (group)
+      writer.attribute("group", *group);
+    writer.end_start_tag();
+    writer.content(acc.result(op.m_function), 2, 1);
+    writer.end_element("result", 1);
+    writer.newline();
+  };
+  writer.start_element("results", 0);
+  writer.end_start_tag();
+  for (std::size_t i = 0; i < operations.size(); ++i) {
+    auto const &op = operations[i];
+    if (op.m_group.empty()) {
+      assert(accumulators[i].count != 0);
+      write(op, accumulators[i], std::nullopt);
+      continue;
+    }
+    assert(groups.size() == operations.size());
+    for (std::size_t g = 0; g < groups[i].size(); ++g)
+      write(op, groups[i].state(g), groups[i].key(g));
+  }
+  writer.end_element("results", 0);
+}
+
+/**
+ * @brief Write the results of the operations as XML document.
+ *
+ * @param evaluator The evaluator all data was processed by.
+ * @param output Stream to write the resulting XML document to.
+ */
+void write_results(Evaluator const &evaluator, std::ostream &output) {
+  write_results(evaluator.operations(), evaluator.accumulators(), output,
+                evaluator.groups());
+}
+
+/**
+ * @brief Evaluate @p operations on the data of @p data_doc.
+ *
+ * The fields the operations read are extracted into Columns first. Every
+ * distinct filter is run once over the key column and every operation
+ * aggregates the selected rows of its value column, see aggregate.
+ * Operations with the same filter and field that keep the same kind of
+ * state share it. Grouped operations and the operations of type "path"
+ * are evaluated by an Evaluator in a single walk of the tree, see
+ * detail::walk.
+ *
+ * @param data_doc The parsed data document.
+ * @param operations The operations to evaluate.
+ * @param output Stream to write the resulting XML document to.
+ */
+void eval(XML::XML_Doc const &data_doc, std::vector<Operation> operations,
+          std::ostream &output) {
+  std::vector<Accumulator> accumulators(operations.size());
+  std::vector<Groups> groups(operations.size());
+  std::vector<Operation> walked, columnar;
+  std::vector<std::size_t> walked_index, columnar_index;
+  for (std::size_t i = 0; i < operations.size(); ++i) {
+    auto const walk = not operations[i].m_group.empty() or
+                      operations[i].m_compiled_path.has_value();
+    (walk ? walked : columnar).push_back(operations[i]);
+    (walk ? walked_index : columnar_index).push_back(i);
+  }
+  if (not walked.empty()) {
+    Evaluator evaluator(std::move(walked));
+    evaluator.use_symbols(*data_doc.m_symbols);
+    detail::walk(data_doc, evaluator);
+    for (std::size_t j = 0; j < walked_index.size(); ++j) {
+      accumulators[walked_index[j]] = evaluator.accumulators()[j];
+      groups[walked_index[j]] = evaluator.groups()[j];
+    }
+    if (columnar.empty()) {
+      write_results(operations, accumulators, output, groups);
+      return;
+    }
+  }
+
+  Columns const columns(data_doc, columnar);
+  std::vector<std::string_view> patterns;
+  std::vector<std::vector<std::size_t>> selections;
+  // the filter, column, kind of extra state and state of every distinct
+  // combination
+  std::vector<std::tuple<std::size_t, std::size_t, std::size_t, Accumulator>>
+      states;
+  for (std::size_t j = 0; j < columnar.size(); ++j) {
+    auto const &op = columnar[j];
+    auto const filter = static_cast<std::size_t>(std::distance(
+        patterns.begin(),
+        std::find(patterns.begin(), patterns.end(), op.m_filter)));
+    if (filter == patterns.size()) {
+      patterns.push_back(op.m_filter);
+      selections.push_back(columns.select(op.m_compiled_filter));
+    }
+    auto const column = columns.column_index(j);
+    auto const kind = Accumulator::for_function(op.m_function).extra.index();
+    auto state = std::find_if(states.begin(), states.end(), [&](auto &s) {
+      return std::get<0>(s) == filter and std::get<1>(s) == column and
+             std::get<2>(s) == kind;
+    });
+    if (state == states.end()) {
+      auto const &rows = selections[filter];
+      states.emplace_back(
+          filter, column, kind,
+          aggregate(columns.values(column), rows, op.m_function));
+      state = std::prev(states.end());
+      // values that could not be extracted are NaN and make the sum NaN
+      if (std::isnan(std::get<3>(*state).sum))
+        columns.require_values(column, rows);
+    }
+    accumulators[columnar_index[j]] = std::get<3>(*state);
+  }
+  write_results(operations, accumulators, output, groups);
+}
+
+/**
+ * @brief Evaluate @p operations on the data of the binary document
+ * @p data_doc.
+ *
+ * @param data_doc The data document, e.g. a memory mapped cache.
+ * @param operations The operations to evaluate.
+ * @param output Stream to write the resulting XML document to.
+ * @throws std::runtime_error If an operation is of type "path".
+ */
+void eval(XML::BinaryDocument const &data_doc,
+          std::vector<Operation> operations, std::ostream &output) {
+  Evaluator evaluator(std::move(operations));
+  if (evaluator.has_paths())
+    throw std::runtime_error("Path operations need a parsed or streamed "
+                             "document");
+  evaluator.use_symbols(data_doc.symbols());
+  for (std::size_t i = 0; i < data_doc.size(); ++i)
+    evaluator.process(data_doc[i]);
+  write_results(evaluator, output);
+}
+
+/**
+ * @brief Evaluate @p operations on the data of the lazy document @p data_doc.
+ *
+ * Only the start tags of the elements and the children the operations ask
+ * for are decoded.
+ *
+ * @param data_doc The lazily decoded data document.
+ * @param operations The operations to evaluate.
+ * @param output Stream to write the resulting XML document to.
+ * @throws std::runtime_error If an operation is of type "path".
+ */
+void eval(XML::LazyDocument const &data_doc,
+          std::vector<Operation> operations, std::ostream &output) {
+  Evaluator evaluator(std::move(operations));
+  if (evaluator.has_paths())
+    throw std::runtime_error("Path operations need a parsed or streamed "
+                             "document");
+  for (std::size_t i = 0; i < data_doc.size(); ++i)
+    evaluator.process(data_doc[i]);
+  write_results(evaluator, output);
+}
+
+/**
+ * @brief Evaluate @p operations on the data of @p data_doc using the threads
+ * of @p pool.
+ *
+ * The operations are grouped by filter and the elements are split into
+ * ranges, every pair of group and range is evaluated as a separate task.
+ * The operations of type "path" are evaluated by one more task walking the
+ * whole tree.
+ * The partial states of the ranges, including the groups of grouped
+ * operations, are merged in document order and the results are written in
+ * the order of @p operations. The results equal the ones of the single
+ * threaded evaluation up to the rounding of the sums.
+ *
+ * @param data_doc The parsed data document, it is only read.
+ * @param operations The operations to evaluate.
+ * @param pool The threads to evaluate on.
+ * @param output Stream to write the resulting XML document to.
+ * @param min_range_size Lower bound of the number of elements of a range.
+ */
+void eval(XML::XML_Doc const &data_doc, std::vector<Operation> operations,
+          XML::ThreadPool &pool, std::ostream &output,
+          std::size_t min_range_size = 4096) {
+  // operations sharing a filter are evaluated together
+  std::vector<std::vector<std::size_t>> groups;
+  std::vector<std::size_t> path_ops;
+  for (std::size_t i = 0; i < operations.size(); ++i) {
+    if (operations[i].m_compiled_path) {
+      path_ops.push_back(i);
+      continue;
+    }
+    auto const group =
+        std::find_if(groups.begin(), groups.end(), [&](auto const &g) {
+          return operations[g.front()].m_filter == operations[i].m_filter;
+        });
+    if (group == groups.end())
+      groups.push_back({i});
+    else
+      group->push_back(i);
+  }
+
+  // enough ranges to keep all threads busy, but not smaller than the minimum
+  auto const elements = data_doc.size();
+  auto const filters = std::max<std::size_t>(groups.size(), 1);
+  auto const wanted_ranges = (4 * pool.size() + filters - 1) / filters;
+  auto const range_size =
+      std::max({min_range_size, elements / wanted_ranges, std::size_t{1}});
+  auto const ranges = std::max<std::size_t>(
+      1, (elements + range_size - 1) / range_size);
+
+  using Partial = std::pair<std::vector<Accumulator>, std::vector<Groups>>;
+  std::vector<std::vector<std::future<Partial>>> partials(groups.size());
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    std::vector<Operation> group_ops;
+    for (auto const i : groups[g])
+      group_ops.push_back(operations[i]);
+    for (std::size_t r = 0; r < ranges; ++r) {
+      auto const first = std::min(r * range_size, elements);
+      auto const last = std::min(first + range_size, elements);
+      partials[g].push_back(
+          pool.submit([&data_doc, group_ops, first, last]() {
+            Evaluator evaluator(group_ops);
+            evaluator.use_symbols(*data_doc.m_symbols);
+            for (auto i = first; i < last; ++i)
+              evaluator.process(*data_doc[i]);
+            return Partial(evaluator.accumulators(), evaluator.groups());
+          }));
+    }
+  }
+  // paths depend on the ancestors, they are matched in one walk of the tree
+  if (not path_ops.empty()) {
+    std::vector<Operation> walked;
+    for (auto const i : path_ops)
+      walked.push_back(operations[i]);
+    groups.push_back(std::move(path_ops));
+    partials.emplace_back();
+    partials.back().push_back(pool.submit([&data_doc, walked]() {
+      Evaluator evaluator(walked);
+      evaluator.use_symbols(*data_doc.m_symbols);
+      detail::walk(data_doc, evaluator);
+      return Partial(evaluator.accumulators(), evaluator.groups());
+    }));
+  }
+
+  // all tasks refer to data_doc, wait for them before any error is rethrown
+  for (auto const &group_partials : partials) {
+    for (auto const &partial : group_partials)
+      partial.wait();
+  }
+  std::vector<Accumulator> accumulators(operations.size());
+  std::vector<Groups> key_groups;
+  for (auto const &op : operations)
+    key_groups.emplace_back(op.m_function,
+                            op.m_group.empty() ? 0 : op.m_group_limit);
+  for (std::size_t g = 0; g < groups.size(); ++g) {
+    for (auto &partial : partials[g]) {
+      auto const [group_accumulators, partial_groups] = partial.get();
+      for (std::size_t k = 0; k < groups[g].size(); ++k) {
+        accumulators[groups[g][k]].merge(group_accumulators[k]);
+        key_groups[groups[g][k]].merge(partial_groups[k]);
+      }
+    }
+  }
+  write_results(operations, accumulators, output, key_groups);
+}
+
+/**
+ * @brief Evaluate the operations of @p op_doc on the data of @p data_doc.
+ *
+ * @param data_doc The parsed data document.
+ * @param op_doc The parsed operations document.
+ * @param output Stream to write the resulting XML document to.
+ */
+void eval(XML::XML_Doc const &data_doc, XML::XML_Doc const &op_doc,
+          std::ostream &output) {
+  eval(data_doc, collect_operations(op_doc), output);
+}
+
+namespace detail {
+
+/**
+ * @brief The open elements of a streamed data document.
+ *
+ * The events of a reader are collected in a frame per open element, the
+ * element is passed to the evaluator when it is closed. Frames are reused
+ * to avoid allocations, only the first depth ones are open. If the
+ * evaluator has paths, elements are also entered once their attributes are
+ * complete and left when they are closed.
+ */
+template <class String> class StreamFolder {
+public:
+  explicit StreamFolder(Evaluator &evaluator) : m_evaluator(evaluator) {}
+
+  /** @brief Add the next event of the document. */
+  void add(XML::BasicEvent<String> event) {
+    std::visit(
+        [this](auto &&arg) {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, XML::BasicStartTagBegin<String>>) {
+            end_attributes();
+            start();
+            if (m_evaluator.has_paths()) {
+              m_name = std::move(arg.name);
+              m_entering = true;
+            }
+          } else if constexpr (std::is_same_v<T, XML::BasicAttribute<String>>) {
+            m_open[m_depth - 1].attributes.push_back(std::move(arg.key_val));
+            m_open[m_depth - 1].attribute_symbols.push_back(arg.key_symbol);
+          } else if constexpr (std::is_same_v<T, XML::BasicContent<String>>) {
+            end_attributes();
+            m_open[m_depth - 1].content = std::move(arg.content);
+          } else if constexpr (std::is_same_v<T, XML::BasicEndTag<String>>) {
+            end_attributes();
+            close(arg.name, arg.symbol);
+          }
+        },
+        event);
+  }
+
+  /** @brief Number of open elements. */
+  std::size_t depth() const { return m_depth; }
+
+  /**
+   * @brief Enter the innermost element into the evaluator if that is still
+   * due, its attributes are complete.
+   */
+  void end_attributes() {
+    if (not m_entering)
+      return;
+    m_entering = false;
+    m_evaluator.enter(m_open[m_depth - 1], m_name);
+  }
+
+private:
+  void start() {
+    if (m_depth == m_open.size())
+      m_open.emplace_back();
+    else
+      m_open[m_depth].clear();
+    ++m_depth;
+  }
+
+  void close(String const &name, XML::Symbol symbol) {
+    auto const &elem = m_open[m_depth - 1];
+    m_evaluator.process(elem);
+    if (m_evaluator.has_paths())
+      m_evaluator.leave(elem);
+    if (m_depth > 1)
+      m_open[m_depth - 2].add_child(name, symbol, elem.content);
+    --m_depth;
+  }
+
+  Evaluator &m_evaluator;
+  std::vector<ElementFrame<String>> m_open;
+  std::size_t m_depth = 0;
+  /** Name of the innermost element, if it is not entered yet. */
+  String m_name;
+  bool m_entering = false;
+};
+
+} // namespace detail
+
+/**
+ * @brief Process the elements of a streamed data document by @p evaluator.
+ *
+ * The data is evaluated in a single pass while it is read, elements are
+ * visited in the same order as in the parsed XML::XML_Doc, i.e. when they
+ * are closed. Only the currently open elements are kept in memory.
+ *
+ * @param reader Reader of the data document.
+ * @param evaluator The evaluator to fold the elements into.
+ */
+template <class LexerT>
+void process_stream(XML::Reader<LexerT> reader, Evaluator &evaluator) {
+  using String = typename XML::Reader<LexerT>::string_type;
+  if (auto const &symbols = reader.lexer().m_symbols)
+    evaluator.intern_symbols(*symbols);
+  detail::StreamFolder<String> folder(evaluator);
+  while (auto event = reader.next())
+    folder.add(std::move(*event));
+}
+
+/**
+ * @brief Evaluate the operations on a streamed data document.
+ *
+ * @see process_stream
+ *
+ * @param reader Reader of the data document.
+ * @param operations The operations to evaluate.
+ * @param output Stream to write the resulting XML document to.
+ */
+template <class LexerT>
+void eval_stream(XML::Reader<LexerT> reader,
+                 std::vector<Operation> operations, std::ostream &output) {
+  Evaluator evaluator(std::move(operations));
+  process_stream(std::move(reader), evaluator);
+  write_results(evaluator, output);
+}
+
+/**
+ * @brief Evaluation of a data document that is received in chunks.
+ *
+ * Every chunk is lexed and folded into the aggregates as soon as it is fed,
+ * so receiving, parsing and evaluating are pipelined and only the open
+ * elements and a partial token are kept in memory.
+ */
+class PushEvaluator {
+public:
+  /**
+   * @param operations The operations to evaluate, only the fields they read
+   * are lexed.
+   */
+  explicit PushEvaluator(std::vector<Operation> operations)
+      : m_reader(XML::PushLexer(std::make_shared<XML::SymbolTable>(),
+                                make_projection(operations))),
+        m_evaluator(std::move(operations)), m_folder(m_evaluator) {
+    m_evaluator.intern_symbols(*m_reader.lexer().m_symbols);
+  }
+
+  PushEvaluator(PushEvaluator const &) = delete;
+  PushEvaluator &operator=(PushEvaluator const &) = delete;
+
+  /** @brief Evaluate the elements completed by the next @p chunk. */
+  void feed(std::string_view chunk) {
+    m_reader.lexer().feed(chunk);
+    read();
+  }
+
+  /**
+   * @brief Evaluate the rest of the data and write the results.
+   *
+   * @param output Stream to write the resulting XML document to.
+   */
+  void finish(std::ostream &output) {
+    m_reader.lexer().finish();
+    read();
+    write_results(m_evaluator, output);
+  }
+
+private:
+  void read() {
+    while (auto event = m_reader.next())
+      m_folder.add(std::move(*event));
+  }
+
+  XML::Reader<XML::PushLexer> m_reader;
+  Evaluator m_evaluator;
+  detail::StreamFolder<std::string> m_folder;
+};
+
+/**
+ * @brief Evaluate the operations read from @p ops on the data read from
+ * @p data.
+ *
+ * The operations are read first, the data is streamed, see eval_stream.
+ * Only the fields the operations read are lexed, see make_projection.
+ */
+void eval(std::istream &data, std::istream &ops, std::ostream &output) {
+  auto operations =
+      collect_operations(XML::Parser(XML::Lexer(ops).tokenize()).parse());
+  auto projection = make_projection(operations);
+  eval_stream(XML::Reader<XML::Lexer>(
+                  XML::Lexer(data, std::make_shared<XML::SymbolTable>(),
+                             std::move(projection))),
+              std::move(operations), output);
+}
+
+/**
+ * @brief Evaluate the operations in the buffer @p ops on the data in the
+ * buffer @p data, e.g. memory mapped files.
+ *
+ * @see eval(std::istream &, std::istream &, std::ostream &)
+ */
+void eval(std::string_view data, std::string_view ops, std::ostream &output) {
+  auto operations = collect_operations(
+      XML::StringParser(XML::StringLexer(ops).tokenize()).parse());
+  auto projection = make_projection(operations);
+  eval_stream(XML::Reader<XML::StringLexer>(XML::StringLexer(
+                  data, std::make_shared<XML::SymbolTable>(),
+                  std::move(projection))),
+              std::move(operations), output);
 }
 
 } // namespace Operation
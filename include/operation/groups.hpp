@@ -0,0 +1,115 @@
+#ifndef GROUPS_HPP
+#define GROUPS_HPP
+
+#include <cstddef>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "accumulator.hpp"
+
+/** @file groups.hpp
+ *  @brief This file contains the per-key states of grouped operations.
+ */
+
+namespace Operation {
+
+/**
+ * @brief Hash table of the states of an operation per group key.
+ *
+ * The groups are kept in the order their keys first occur, so folding the
+ * elements in document order, or merging the states of consecutive ranges
+ * in document order, gives the groups in the same order. The number of
+ * groups is bounded by a limit, exceeding it is an error instead of an
+ * unbounded table.
+ */
+class Groups {
+public:
+  /**
+   * @param func The function the states are made for, see
+   * Accumulator::for_function.
+   * @param limit Maximum number of groups.
+   */
+  explicit Groups(Function func = Function::sum, std::size_t limit = 0)
+      : m_function(func), m_limit(limit) {}
+
+  // the index refers to the keys of the table it belongs to
+  Groups(Groups const &other)
+      : m_function(other.m_function), m_limit(other.m_limit),
+        m_keys(other.m_keys), m_states(other.m_states) {
+    reindex();
+  }
+  Groups(Groups &&) = default;
+  Groups &operator=(Groups other) {
+    std::swap(m_function, other.m_function);
+    std::swap(m_limit, other.m_limit);
+    m_keys.swap(other.m_keys);
+    m_index.swap(other.m_index);
+    m_states.swap(other.m_states);
+    return *this;
+  }
+
+  /**
+   * @brief The state of the group @p key, a new group is added if there is
+   * none.
+   * @throws std::runtime_error If a new group would exceed the limit.
+   */
+  Accumulator &operator[](std::string_view key) {
+    auto const it = m_index.find(key);
+    if (it != m_index.end())
+      return m_states[it->second];
+    if (m_states.size() == m_limit)
+      throw std::runtime_error("Number of groups exceeds the limit of " +
+                               std::to_string(m_limit));
+    m_keys.emplace_back(key);
+    m_index.emplace(m_keys.back(), m_states.size());
+    m_states.push_back(Accumulator::for_function(m_function));
+    return m_states.back();
+  }
+
+  /**
+   * @brief Merge the groups of @p other into these groups.
+   *
+   * Groups that are new to this table are appended in the order of
+   * @p other.
+   *
+   * @throws std::runtime_error If the merged groups exceed the limit.
+   */
+  void merge(Groups const &other) {
+    for (std::size_t i = 0; i < other.size(); ++i)
+      (*this)[other.key(i)].merge(other.state(i));
+  }
+
+  /** @brief Number of groups. */
+  std::size_t size() const { return m_states.size(); }
+
+  bool empty() const { return m_states.empty(); }
+
+  /** @brief The key of the group @p i, in the order of first occurrence. */
+  std::string_view key(std::size_t i) const { return m_keys[i]; }
+
+  /** @brief The state of the group @p i. */
+  Accumulator const &state(std::size_t i) const { return m_states[i]; }
+
+private:
+  void reindex() {
+    m_index.clear();
+    for (std::size_t i = 0; i < m_keys.size(); ++i)
+      m_index.emplace(m_keys[i], i);
+  }
+
+  Function m_function;
+  std::size_t m_limit;
+  /** The keys, a deque keeps the views of m_index valid as it grows. */
+  std::deque<std::string> m_keys;
+  std::unordered_map<std::string_view, std::size_t> m_index;
+  std::vector<Accumulator> m_states;
+};
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ios>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "eval.hpp"
+#include "lexer.hpp"
+#include "number.hpp"
+#include "reader.hpp"
+#include "result_cache.hpp"
+
+/** @file incremental.hpp
+ *  @brief This file contains the evaluation of data documents that grow.
+ */
+
+namespace Operation {
+
+/**
+ * @brief Saved state of an incremental evaluation.
+ *
+ * The state belongs to the data in front of offset, which ends with a child
+ * of the root. Appending children to the root, i.e. rewriting the data
+ * behind offset, keeps the state valid.
+ */
+struct IncrementalState {
+  /** End of the last evaluated child of the root, 0 if there is none. */
+  std::uint64_t offset = 0;
+  /** Checksum of the data in front of offset, see prefix_checksum. */
+  std::uint64_t checksum = 0;
+  /** The ResultCache::key of each operation. */
+  std::vector<ResultCache::Key> keys;
+  /** The state of each operation after the data in front of offset. */
+  std::vector<Accumulator> accumulators;
+
+  /**
+   * @brief Read a state written by save.
+   *
+   * A state that cannot be read is reset, the next evaluation then starts
+   * from the beginning of the data.
+   */
+  void load(std::istream &input) {
+    *this = {};
+    std::string offset_str, checksum_str;
+    if (not(input >> offset_str >> checksum_str) or
+        not parse(offset_str, 10, offset) or
+        not parse(checksum_str, 16, checksum)) {
+      *this = {};
+      return;
+    }
+    std::string key, count, sum, min, max, extra;
+    while (input >> key >> count >> sum >> min >> max >> extra) {
+      ResultCache::Key parsed_key = 0;
+      Accumulator state;
+      std::uint64_t parsed_count = 0;
+      auto const parsed_sum = parse_whole_number(sum);
+      auto const parsed_min = parse_whole_number(min);
+      auto const parsed_max = parse_whole_number(max);
+      if (not parse(key, 16, parsed_key) or
+          not parse(count, 10, parsed_count) or not parsed_sum or
+          not parsed_min or not parsed_max or not state.decode_extra(extra)) {
+        *this = {};
+        return;
+      }
+      state.count = parsed_count;
+      state.sum = *parsed_sum;
+      state.min = *parsed_min;
+      state.max = *parsed_max;
+      keys.push_back(parsed_key);
+      accumulators.push_back(state);
+    }
+  }
+
+  /**
+   * @brief Write the state, the numbers are written exactly.
+   */
+  void save(std::ostream &output) const {
+    output << offset << ' ' << std::hex << checksum << std::dec << '\n'
+           << std::hexfloat;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      auto const &state = accumulators[i];
+      output << std::hex << keys[i] << std::dec << ' ' << state.count << ' '
+             << state.sum << ' ' << state.min << ' ' << state.max << ' '
+             << state.encode_extra() << '\n';
+    }
+  }
+
+private:
+  static bool parse(std::string const &str, int base, std::uint64_t &value) {
+    char *end = nullptr;
+    value = std::strtoull(str.c_str(), &end, base);
+    return end != str.c_str() and *end == '\0';
+  }
+};
+
+/**
+ * @brief Checksum of the data in front of @p offset.
+ *
+ * Only the first and the last 4 KiB are hashed, which covers the start tag
+ * of the root and the end of the evaluated data but keeps the check cheap.
+ * Rewriting the data is detected, changes in between are not.
+ */
+inline std::uint64_t prefix_checksum(std::string_view data,
+                                     std::size_t offset) {
+  constexpr std::size_t window = 4096;
+  offset = std::min(offset, data.size());
+  auto const head = data.substr(0, std::min(offset, window));
+  auto const tail_size = std::min(offset, window);
+  return fnv1a(data.substr(offset - tail_size, tail_size), fnv1a(head));
+}
+
+/**
+ * @brief Evaluate @p operations on @p data, resuming from @p state.
+ *
+ * If @p state was saved for the same operations on the same data in front
+ * of its offset, only the data behind the offset is lexed and folded into
+ * the saved states. Otherwise all data is evaluated. Either way the results
+ * equal the ones of eval. Documents whose root matches a filter are always
+ * evaluated in full, since the root depends on all of its children. So are
+ * grouped operations, the state does not keep their groups.
+ *
+ * @param data The data document, e.g. a memory mapped file.
+ * @param operations The operations to evaluate.
+ * @param data_id Identity of the data that stays the same when it grows,
+ * e.g. the path of the file.
+ * @param state The state saved by the last evaluation or an empty state.
+ * @param output Stream to write the resulting XML document to.
+ * @return The state to resume the next evaluation from.
+ */
+inline IncrementalState eval_incremental(std::string_view data,
+                                         std::vector<Operation> operations,
+                                         std::string_view data_id,
+                                         IncrementalState const &state,
+                                         std::ostream &output) {
+  using String = std::string_view;
+  IncrementalState next;
+  auto grouped = false;
+  for (auto const &op : operations) {
+    next.keys.push_back(ResultCache::key(data_id, op));
+    grouped = grouped or not op.m_group.empty();
+  }
+  auto const symbols = std::make_shared<XML::SymbolTable>();
+  auto const projection = make_projection(operations);
+  Evaluator evaluator(std::move(operations));
+  evaluator.intern_symbols(*symbols);
+  detail::StreamFolder<String> folder(evaluator);
+
+  // open the root and stop in front of its first child
+  auto resume = not grouped and state.offset != 0 and
+                state.offset <= data.size() and state.keys == next.keys and
+                state.checksum == prefix_checksum(data, state.offset);
+  XML::Reader<XML::StringLexer> head(
+      XML::StringLexer(data, symbols, projection));
+  std::vector<XML::BasicEvent<String>> root_events;
+  if (resume) {
+    while (auto event = head.next()) {
+      if (std::holds_alternative<XML::BasicStartTagBegin<String>>(*event) and
+          head.depth() == 2)
+        break;
+      root_events.push_back(std::move(*event));
+    }
+    resume = head.depth() == 2;
+  }
+  std::size_t begin = 0;
+  if (resume) {
+    for (auto &event : root_events)
+      folder.add(std::move(event));
+    // attributes of the root that paths select are part of the saved states
+    folder.end_attributes();
+    evaluator.resume(state.accumulators);
+    begin = state.offset;
+    next.offset = state.offset;
+    next.accumulators = state.accumulators;
+  }
+  auto reader =
+      resume ? XML::Reader<XML::StringLexer>(
+                   XML::StringLexer(data.substr(begin), symbols, projection),
+                   {head.open_elements().front()},
+                   {head.open_symbols().front()})
+             : XML::Reader<XML::StringLexer>(
+                   XML::StringLexer(data, symbols, projection));
+
+  // remember the states after every child of the root
+  auto root_closed = false;
+  while (auto event = reader.next()) {
+    auto const end = std::holds_alternative<XML::BasicEndTag<String>>(*event);
+    folder.add(std::move(*event));
+    if (not end or root_closed)
+      continue;
+    if (folder.depth() == 1) {
+      next.offset = begin + reader.lexer().m_pos;
+      next.accumulators = evaluator.accumulators();
+    } else if (folder.depth() == 0) {
+      root_closed = true;
+      auto const &final_states = evaluator.accumulators();
+      for (std::size_t i = 0; i < next.accumulators.size(); ++i) {
+        // the root matched a filter
+        if (final_states[i].count != next.accumulators[i].count)
+          next.offset = 0;
+      }
+    }
+  }
+  if (grouped)
+    next.offset = 0;
+  if (next.offset == 0)
+    next.accumulators.clear();
+  next.checksum = prefix_checksum(data, next.offset);
+  write_results(evaluator, output);
+  return next;
+}
+
+} // namespace Operation
+
+#endif
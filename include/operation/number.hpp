@@ -0,0 +1,143 @@
+#ifndef NUMBER_HPP
+#define NUMBER_HPP
+
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+/** @file number.hpp
+ *  @brief This file contains the conversion of values to numbers.
+ */
+
+namespace Operation {
+
+namespace detail {
+
+/** @brief Whitespace as skipped by std::strtod in the "C" locale. */
+constexpr bool is_space(char c) {
+  return c == ' ' or c == '\t' or c == '\n' or c == '\r' or c == '\f' or
+         c == '\v';
+}
+
+/** @brief Parse @p str with std::strtod, copying it to a local buffer. */
+inline std::from_chars_result parse_number_strtod(std::string_view str,
+                                                  double &value) {
+  char buffer[128];
+  if (str.size() >= sizeof(buffer))
+    str = str.substr(0, sizeof(buffer) - 1);
+  std::memcpy(buffer, str.data(), str.size());
+  buffer[str.size()] = '\0';
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtod(buffer, &end);
+  auto const ptr = str.data() + (end - buffer);
+  if (end == buffer)
+    return {ptr, std::errc::invalid_argument};
+  if (errno == ERANGE)
+    return {ptr, std::errc::result_out_of_range};
+  return {ptr, std::errc()};
+}
+
+/**
+ * @brief Parse the number at the beginning of @p str into @p value.
+ *
+ * @return The end of the number and std::errc::invalid_argument if @p str
+ * does not start with a number, std::errc::result_out_of_range if the number
+ * is out of range.
+ */
+inline std::from_chars_result parse_number(std::string_view str,
+                                           double &value) {
+  std::size_t begin = 0;
+  while (begin < str.size() and is_space(str[begin]))
+    ++begin;
+  str.remove_prefix(begin);
+  // std::from_chars neither accepts a plus sign nor hexadecimal numbers
+  if (not str.empty() and str[0] == '+') {
+    if (str.size() > 1 and str[1] == '-')
+      return {str.data(), std::errc::invalid_argument};
+    str.remove_prefix(1);
+  }
+  std::size_t const sign = not str.empty() and str[0] == '-' ? 1 : 0;
+  auto const hex = str.size() > sign + 1 and str[sign] == '0' and
+                   (str[sign + 1] == 'x' or str[sign + 1] == 'X');
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  if (hex) {
+    // the digits behind the prefix, e.g. the exact numbers written as %a
+    auto const digits = str.substr(sign + 2);
+    if (not digits.empty() and digits[0] != '-' and digits[0] != '+') {
+      auto const result =
+          std::from_chars(digits.data(), digits.data() + digits.size(),
+                          value, std::chars_format::hex);
+      if (result.ec != std::errc::invalid_argument) {
+        if (sign != 0)
+          value = -value;
+        return result;
+      }
+    }
+    return parse_number_strtod(str, value);
+  }
+  return std::from_chars(str.data(), str.data() + str.size(), value);
+#else
+  if (hex)
+    return parse_number_strtod(str, value);
+  return parse_number_strtod(str, value);
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief Parse the number at the beginning of @p str.
+ *
+ * Accepts what std::stod accepts for decimal numbers: leading whitespace, an
+ * optional sign, fixed or scientific notation, "inf" and "nan". Trailing
+ * characters are ignored. The conversion does not allocate, does not depend
+ * on the locale and does not throw.
+ *
+ * @return The number or an empty optional if @p str does not start with a
+ * number or the number is out of range.
+ */
+inline std::optional<double> parse_number(std::string_view str) {
+  double value = 0.0;
+  if (detail::parse_number(str, value).ec != std::errc())
+    return std::nullopt;
+  return value;
+}
+
+/**
+ * @brief Parse @p str like parse_number, but only if all of it is the
+ * number, e.g. a field of a saved state.
+ */
+inline std::optional<double> parse_whole_number(std::string_view str) {
+  double value = 0.0;
+  auto const [ptr, ec] = detail::parse_number(str, value);
+  if (ec != std::errc() or ptr != str.data() + str.size())
+    return std::nullopt;
+  return value;
+}
+
+/**
+ * @brief Convert @p str to a double like std::stod, without allocating.
+ *
+ * @throws std::invalid_argument If @p str does not start with a number.
+ * @throws std::out_of_range If the number is out of range.
+ */
+inline double to_double(std::string_view str) {
+  double value = 0.0;
+  auto const error = detail::parse_number(str, value).ec;
+  if (error == std::errc::result_out_of_range)
+    throw std::out_of_range("Number out of range: " + std::string(str));
+  if (error != std::errc())
+    throw std::invalid_argument("Not a number: " + std::string(str));
+  return value;
+}
+
+} // namespace Operation
+
+#endif
@@ -1,24 +1,53 @@
 #ifndef OPERATION_HPP
 #define OPERATION_HPP
 
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
 #include <string>
 
+#include "accumulator.hpp"
+#include "filter.hpp"
 #include "parser.hpp"
+#include "path.hpp"
 
 namespace Operation {
 
 struct Operation {
+  /** Maximum number of groups if the operation does not set a limit. */
+  static constexpr std::size_t default_group_limit = 1024;
+
   std::string m_name;
   std::string m_type;
   std::string m_func;
   std::string m_attrib;
   std::string m_filter;
+  /** Attribute whose values the results are grouped by, empty if none. */
+  std::string m_group;
+  /** Maximum number of groups, bounds the memory of a grouped operation. */
+  std::size_t m_group_limit = default_group_limit;
+  /** The function named by m_func. */
+  Function m_function;
+  /** The compiled m_filter. */
+  XML::Filter m_compiled_filter;
+  /** The compiled m_attrib of operations of type "path". */
+  std::optional<Path> m_compiled_path;
   Operation(XML::XML_Element const &op) {
     m_name = op.get_attribute("name");
     m_type = op.get_attribute("type");
     m_func = op.get_attribute("func");
     m_attrib = op.get_attribute("attrib");
     m_filter = op.get_attribute("filter");
+    m_group = op.get_attribute("group");
+    if (auto const limit = op.get_attribute("limit"); not limit.empty()) {
+      if (limit.find_first_not_of("0123456789") != limit.npos)
+        throw std::runtime_error("Invalid group limit: " + std::string(limit));
+      m_group_limit = std::stoul(std::string(limit));
+    }
+    m_function = parse_function(m_func);
+    m_compiled_filter = XML::Filter(m_filter);
+    if (m_type == "path")
+      m_compiled_path = Path(m_attrib);
   }
 };
 
@@ -0,0 +1,251 @@
+#ifndef PATH_HPP
+#define PATH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** @file path.hpp
+ *  @brief This file contains the path expressions selecting values of the
+ *  data and their matching while the data is streamed.
+ */
+
+namespace Operation {
+
+/**
+ * @brief A compiled path expression, a subset of XPath.
+ *
+ * A path is a sequence of steps separated by "/" (child) or "//"
+ * (descendant), optionally followed by "/@attr" to select an attribute
+ * instead of the content of the elements:
+ *
+ *     city/district/area
+ *     //area
+ *     city[@country='DE']/@population
+ *
+ * A step is an element name or "*" for any element, followed by any number
+ * of predicates "[@attr='value']" (the attribute equals the value) or
+ * "[@attr]" (the attribute is not empty). Relative paths start at the root
+ * element, i.e. "city" selects the children of the root named city. Paths
+ * starting with "/" or "//" start at the document, i.e. "/data" selects the
+ * root if it is named data and "//area" all elements named area.
+ */
+class Path {
+public:
+  /** A test on an attribute of an element. */
+  struct Predicate {
+    std::string attribute;
+    /** The value the attribute has to equal, any non-empty value if none. */
+    std::optional<std::string> value;
+  };
+
+  struct Step {
+    /** Whether the step selects descendants instead of children. */
+    bool descendant = false;
+    /** Name of the selected elements, "*" selects all. */
+    std::string name;
+    std::vector<Predicate> predicates;
+  };
+
+  /** Maximum number of steps, the states of a step fit in 64 bits. */
+  static constexpr std::size_t max_steps = 63;
+
+  /**
+   * @brief Compile @p expression.
+   * @throws std::runtime_error If @p expression is no valid path.
+   */
+  explicit Path(std::string_view expression) : m_expression(expression) {
+    std::size_t pos = 0;
+    auto const at = [&](char c) {
+      return pos < expression.size() and expression[pos] == c;
+    };
+    auto const fail = [&]() -> void {
+      throw std::runtime_error("Invalid path: " + m_expression);
+    };
+    auto const name = [&]() {
+      auto const begin = pos;
+      while (pos < expression.size() and
+             std::string_view("/[]@='\" \t\n").find(expression[pos]) ==
+                 std::string_view::npos)
+        ++pos;
+      if (pos == begin)
+        fail();
+      return std::string(expression.substr(begin, pos - begin));
+    };
+
+    // the axis of the next step
+    auto descendant = false;
+    auto const separator = [&]() {
+      ++pos;
+      descendant = at('/');
+      if (descendant)
+        ++pos;
+    };
+    m_absolute = at('/');
+    if (m_absolute)
+      separator();
+    while (true) {
+      if (at('@')) {
+        ++pos;
+        m_attribute = name();
+        if (descendant or pos != expression.size() or
+            (m_absolute and m_steps.empty()))
+          fail();
+        break;
+      }
+      Step step;
+      step.descendant = descendant;
+      step.name = name();
+      while (at('[')) {
+        ++pos;
+        if (not at('@'))
+          fail();
+        ++pos;
+        Predicate predicate{name(), std::nullopt};
+        if (at('=')) {
+          ++pos;
+          auto const quote = pos < expression.size() ? expression[pos] : '\0';
+          if (quote != '\'' and quote != '"')
+            fail();
+          auto const end = expression.find(quote, ++pos);
+          if (end == std::string_view::npos)
+            fail();
+          predicate.value = std::string(expression.substr(pos, end - pos));
+          pos = end + 1;
+        }
+        if (not at(']'))
+          fail();
+        ++pos;
+        step.predicates.push_back(std::move(predicate));
+      }
+      m_steps.push_back(std::move(step));
+      if (pos == expression.size())
+        break;
+      if (not at('/'))
+        fail();
+      separator();
+    }
+    if (m_steps.size() > max_steps)
+      throw std::runtime_error("Too many steps in path: " + m_expression);
+  }
+
+  std::string const &expression() const { return m_expression; }
+
+  std::vector<Step> const &steps() const { return m_steps; }
+
+  /** @brief Whether the path starts at the document instead of the root. */
+  bool absolute() const { return m_absolute; }
+
+  /** @brief The selected attribute, empty if the contents are selected. */
+  std::string const &attribute() const { return m_attribute; }
+
+private:
+  std::string m_expression;
+  std::vector<Step> m_steps;
+  bool m_absolute = false;
+  std::string m_attribute;
+};
+
+/**
+ * @brief Automaton matching a Path against the elements of a document in
+ * document order.
+ *
+ * State i of an element means that its ancestors-or-self matched the first
+ * i steps, with the last of them matching the element itself. The states
+ * of an open element are a bit mask computed from the ones of its parent
+ * when it is entered, so every element is tested once against the steps
+ * that can follow, independent of its depth. States followed by a
+ * descendant step are passed on to all descendants. Only the states of the
+ * open elements are kept.
+ */
+class PathMatcher {
+public:
+  explicit PathMatcher(Path path) : m_path(std::move(path)) {
+    auto const &steps = m_path.steps();
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+      if (steps[i].descendant)
+        m_descendant_next |= bit(i);
+    }
+    m_accept = bit(steps.size());
+    // the document, relative paths are anchored at the root instead
+    if (m_path.absolute())
+      m_frames.push_back({bit(0), bit(0) & m_descendant_next});
+    else
+      m_frames.push_back({0, 0});
+  }
+
+  Path const &path() const { return m_path; }
+
+  /**
+   * @brief Enter the element @p elem named @p name, whose attributes are
+   * complete.
+   *
+   * @return Whether the path selects @p elem.
+   */
+  template <class Element>
+  bool enter(Element const &elem, std::string_view name) {
+    auto const &parent = m_frames.back();
+    Frame frame{0, parent.inherited};
+    if (m_frames.size() == 1 and not m_path.absolute()) {
+      frame.states = bit(0);
+    } else {
+      auto const &steps = m_path.steps();
+      auto candidates = parent.states | parent.inherited;
+      candidates &= ~m_accept;
+      for (std::size_t i = 0; candidates != 0; ++i, candidates >>= 1) {
+        if ((candidates & 1) != 0 and matches(steps[i], elem, name))
+          frame.states |= bit(i + 1);
+      }
+    }
+    frame.inherited |= frame.states & m_descendant_next;
+    m_frames.push_back(frame);
+    return (frame.states & m_accept) != 0;
+  }
+
+  /** @brief Whether the path selects the innermost entered element. */
+  bool selected() const { return (m_frames.back().states & m_accept) != 0; }
+
+  /** @brief Leave the innermost entered element. */
+  void leave() { m_frames.pop_back(); }
+
+private:
+  struct Frame {
+    /** The states of the element. */
+    std::uint64_t states;
+    /** States of ancestors whose next step selects descendants. */
+    std::uint64_t inherited;
+  };
+
+  static constexpr std::uint64_t bit(std::size_t i) {
+    return std::uint64_t{1} << i;
+  }
+
+  template <class Element>
+  static bool matches(Path::Step const &step, Element const &elem,
+                      std::string_view name) {
+    if (step.name != "*" and step.name != name)
+      return false;
+    for (auto const &predicate : step.predicates) {
+      auto const value = elem.get_attribute(predicate.attribute);
+      if (predicate.value ? value != *predicate.value : value.empty())
+        return false;
+    }
+    return true;
+  }
+
+  Path m_path;
+  /** States followed by a descendant step. */
+  std::uint64_t m_descendant_next = 0;
+  /** The state of elements that matched all steps. */
+  std::uint64_t m_accept = 0;
+  /** The states of the document and of the open elements. */
+  std::vector<Frame> m_frames;
+};
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef REDUCTION_HPP
+#define REDUCTION_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "simd.hpp"
+
+/** @file reduction.hpp
+ *  @brief This file contains the vectorized reduction of arrays of values.
+ */
+
+namespace Operation {
+
+namespace detail {
+
+/** Number of values a kernel reduces, larger arrays are split in halves. */
+constexpr std::size_t pairwise_block = 256;
+
+/** Signature of the kernels reducing at most pairwise_block values. */
+using reduce_kernel = Accumulator (*)(double const *, std::size_t);
+
+/** @brief Reduce the values one at a time. */
+inline Accumulator reduce_scalar(double const *values, std::size_t count) {
+  Accumulator state;
+  for (std::size_t i = 0; i < count; ++i)
+    state.add(values[i]);
+  return state;
+}
+
+#ifdef YAXP_X86_SIMD
+
+/**
+ * @brief Reduce the values two at a time.
+ *
+ * The new value is the first operand of min and max, which return the
+ * second one if the first is NaN. Like Accumulator::add NaNs are ignored.
+ */
+inline Accumulator reduce_sse2(double const *values, std::size_t count) {
+  auto sum = _mm_setzero_pd();
+  auto min = _mm_set1_pd(std::numeric_limits<double>::infinity());
+  auto max = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    auto const x = _mm_loadu_pd(values + i);
+    sum = _mm_add_pd(sum, x);
+    min = _mm_min_pd(x, min);
+    max = _mm_max_pd(x, max);
+  }
+  alignas(16) double sums[2], mins[2], maxs[2];
+  _mm_store_pd(sums, sum);
+  _mm_store_pd(mins, min);
+  _mm_store_pd(maxs, max);
+  Accumulator state{i, sums[0] + sums[1], std::min(mins[0], mins[1]),
+                    std::max(maxs[0], maxs[1]), {}};
+  for (; i < count; ++i)
+    state.add(values[i]);
+  return state;
+}
+
+/**
+ * @brief Reduce the values four at a time.
+ *
+ * Lambdas do not inherit the target attribute, hence no helpers are used.
+ */
+__attribute__((target("avx2"))) inline Accumulator
+reduce_avx2(double const *values, std::size_t count) {
+  auto sum = _mm256_setzero_pd();
+  auto min = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+  auto max = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    auto const x = _mm256_loadu_pd(values + i);
+    sum = _mm256_add_pd(sum, x);
+    min = _mm256_min_pd(x, min);
+    max = _mm256_max_pd(x, max);
+  }
+  alignas(32) double sums[4], mins[4], maxs[4];
+  _mm256_store_pd(sums, sum);
+  _mm256_store_pd(mins, min);
+  _mm256_store_pd(maxs, max);
+  Accumulator state{i, (sums[0] + sums[1]) + (sums[2] + sums[3]),
+                    std::min(std::min(mins[0], mins[1]),
+                             std::min(mins[2], mins[3])),
+                    std::max(std::max(maxs[0], maxs[1]),
+                             std::max(maxs[2], maxs[3])),
+                    {}};
+  for (; i < count; ++i)
+    state.add(values[i]);
+  return state;
+}
+
+#endif
+
+/**
+ * @brief The fastest kernel supported by the executing CPU.
+ *
+ * The choice is made once at runtime.
+ */
+inline reduce_kernel default_reduce_kernel() {
+#ifdef YAXP_X86_SIMD
+  static reduce_kernel const kernel = __builtin_cpu_supports("avx2")
+                                          ? &reduce_avx2
+                                          : &reduce_sse2;
+  return kernel;
+#else
+  return &reduce_scalar;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief Count, sum, minimum and maximum of @p values in a single pass.
+ *
+ * Blocks of pairwise_block values are reduced by a vectorized kernel and
+ * the sums of the blocks are added pairwise. The rounding error of the sum
+ * grows with the logarithm of the number of values instead of linearly,
+ * so it may differ in the last bits from folding the values one at a time.
+ *
+ * @param values The values to reduce.
+ * @param count Number of values.
+ * @param kernel The kernel to reduce the blocks with.
+ */
+inline Accumulator
+reduce(double const *values, std::size_t count,
+       detail::reduce_kernel kernel = detail::default_reduce_kernel()) {
+  if (count <= detail::pairwise_block)
+    return kernel(values, count);
+  // split at a multiple of the block size, so all but the last are full
+  auto const blocks = (count + detail::pairwise_block - 1) /
+                      detail::pairwise_block;
+  auto const half = blocks / 2 * detail::pairwise_block;
+  auto state = reduce(values, half, kernel);
+  state.merge(reduce(values + half, count - half, kernel));
+  return state;
+}
+
+/** @copydoc reduce */
+inline Accumulator
+reduce(std::vector<double> const &values,
+       detail::reduce_kernel kernel = detail::default_reduce_kernel()) {
+  return reduce(values.data(), values.size(), kernel);
+}
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ios>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "accumulator.hpp"
+#include "number.hpp"
+#include "operation.hpp"
+
+/** @file result_cache.hpp
+ *  @brief This file contains the persistent cache of operation results.
+ */
+
+namespace Operation {
+
+/**
+ * @brief Continue the 64 bit FNV-1a hash @p hash with @p data.
+ *
+ * The hash is the same on every platform and in every run, so it can be
+ * stored.
+ */
+inline std::uint64_t fnv1a(std::string_view data,
+                           std::uint64_t hash = 14695981039346656037ull) {
+  for (auto const c : data) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+/**
+ * @brief Cache of the aggregate states of operations on data files.
+ *
+ * The states are stored under a hash of a fingerprint of the data and all
+ * fields of the operation, so changing either gives a different key. The
+ * cache keeps at most capacity entries, when it is saved the least recently
+ * used ones are dropped. Use times are counted in runs, i.e. calls of
+ * load, so the entries of one run are equally recent.
+ */
+class ResultCache {
+public:
+  using Key = std::uint64_t;
+
+  /**
+   * @param capacity Maximum number of entries that are saved.
+   */
+  explicit ResultCache(std::size_t capacity = 1024) : m_capacity(capacity) {}
+
+  /**
+   * @brief The key of @p operation on the data with fingerprint @p data.
+   *
+   * The key is a fnv1a hash of the fingerprint and the fields.
+   *
+   * @param data Fingerprint of the data, e.g. path, size and modification
+   * time of the file.
+   * @param operation The operation.
+   */
+  static Key key(std::string_view data, Operation const &operation) {
+    Key hash = fnv1a({});
+    auto const limit = std::to_string(operation.m_group_limit);
+    for (std::string_view const field :
+         {data, std::string_view(operation.m_name), {operation.m_type},
+          {operation.m_func}, {operation.m_attrib}, {operation.m_filter},
+          {operation.m_group}, {limit}}) {
+      // separate the fields, so moving chars between them changes the key
+      hash = fnv1a(std::string_view("\xff", 1), fnv1a(field, hash));
+    }
+    return hash;
+  }
+
+  /**
+   * @brief The state stored under @p key, it is marked as used.
+   */
+  std::optional<Accumulator> find(Key key) {
+    auto const it = m_entries.find(key);
+    if (it == m_entries.end())
+      return std::nullopt;
+    it->second.used = m_clock;
+    return it->second.state;
+  }
+
+  /** @brief Store @p state under @p key. */
+  void insert(Key key, Accumulator const &state) {
+    m_entries[key] = {state, m_clock};
+  }
+
+  std::size_t size() const { return m_entries.size(); }
+
+  std::size_t capacity() const { return m_capacity; }
+
+  /**
+   * @brief Read the entries written by save and start a new run.
+   *
+   * Lines that cannot be read are skipped, a damaged cache only costs
+   * recomputations.
+   */
+  void load(std::istream &input) {
+    std::string line;
+    while (std::getline(input, line)) {
+      std::istringstream fields(line);
+      std::string key, count, sum, min, max, extra = "-";
+      std::uint64_t used = 0;
+      if (not(fields >> key >> count >> sum >> min >> max >> used))
+        continue;
+      fields >> extra;
+      Accumulator state;
+      char *end = nullptr;
+      auto const parsed_key = std::strtoull(key.c_str(), &end, 16);
+      if (*end != '\0')
+        continue;
+      state.count = std::strtoull(count.c_str(), &end, 10);
+      if (*end != '\0')
+        continue;
+      auto const parsed_sum = parse_whole_number(sum);
+      auto const parsed_min = parse_whole_number(min);
+      auto const parsed_max = parse_whole_number(max);
+      if (not parsed_sum or not parsed_min or not parsed_max or
+          not state.decode_extra(extra))
+        continue;
+      state.sum = *parsed_sum;
+      state.min = *parsed_min;
+      state.max = *parsed_max;
+      m_entries[parsed_key] = {state, used};
+      m_clock = std::max(m_clock, used);
+    }
+    ++m_clock;
+  }
+
+  /**
+   * @brief Write the capacity most recently used entries.
+   *
+   * The sums, minima and maxima are written exactly as hexadecimal floating
+   * point numbers, followed by the extra state, see
+   * Accumulator::encode_extra.
+   */
+  void save(std::ostream &output) const {
+    std::vector<std::pair<Key, Entry>> entries(m_entries.begin(),
+                                               m_entries.end());
+    std::sort(entries.begin(), entries.end(),
+              [](auto const &a, auto const &b) {
+                return a.second.used != b.second.used
+                           ? a.second.used > b.second.used
+                           : a.first < b.first;
+              });
+    if (entries.size() > m_capacity)
+      entries.resize(m_capacity);
+    output << std::hexfloat;
+    for (auto const &[key, entry] : entries) {
+      output << std::hex << key << std::dec << ' ' << entry.state.count << ' '
+             << entry.state.sum << ' ' << entry.state.min << ' '
+             << entry.state.max << ' ' << entry.used << ' '
+             << entry.state.encode_extra() << '\n';
+    }
+  }
+
+private:
+  struct Entry {
+    Accumulator state;
+    /** The run the entry was last used in. */
+    std::uint64_t used = 0;
+  };
+
+  std::size_t m_capacity;
+  std::unordered_map<Key, Entry> m_entries;
+  /** The current run. */
+  std::uint64_t m_clock = 0;
+};
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,415 @@
+#ifndef SKETCHES_HPP
+#define SKETCHES_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "number.hpp"
+
+/** @file sketches.hpp
+ *  @brief This file contains small mergeable summaries of streamed values.
+ */
+
+namespace Operation {
+
+namespace detail {
+
+/** @brief Append @p value exactly, as hexadecimal floating point number. */
+inline void append_number(std::string &str, double value) {
+  char chars[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  // unlike %a independent of the locale, without the prefix of the digits
+  auto const end = std::to_chars(chars, chars + sizeof(chars), value,
+                                 std::chars_format::hex)
+                       .ptr;
+  std::string_view number(chars, static_cast<std::size_t>(end - chars));
+  if (not number.empty() and number[0] == '-') {
+    str += '-';
+    number.remove_prefix(1);
+  }
+  if (not number.empty() and
+      std::isdigit(static_cast<unsigned char>(number[0])))
+    str += "0x";
+  str += number;
+#else
+  auto const size = std::snprintf(chars, sizeof(chars), "%a", value);
+  str.append(chars, static_cast<std::size_t>(size));
+#endif
+}
+
+/**
+ * @brief Parse the comma separated numbers of @p str.
+ *
+ * @return Whether all of @p str consists of numbers, i.e. there is no empty
+ * field and no whitespace around the numbers.
+ */
+inline bool parse_numbers(std::string_view str, std::vector<double> &numbers) {
+  numbers.clear();
+  if (str.empty())
+    return true;
+  while (true) {
+    auto const end = std::min(str.find(','), str.size());
+    auto const field = str.substr(0, end);
+    if (field.empty() or is_space(field[0]))
+      return false;
+    auto const number = parse_whole_number(field);
+    if (not number)
+      return false;
+    numbers.push_back(*number);
+    if (end == str.size())
+      return true;
+    str.remove_prefix(end + 1);
+  }
+}
+
+} // namespace detail
+
+/**
+ * @brief Mean and sum of squared deviations of the values.
+ *
+ * The values are folded in with Welford's algorithm, which does not lose
+ * precision like the difference of the sum of squares and the squared sum.
+ */
+struct Moments {
+  std::size_t count = 0;
+  double mean = 0.0;
+  /** Sum of the squared deviations from the mean. */
+  double m2 = 0.0;
+
+  /** @brief Fold @p value into the state. */
+  void add(double value) {
+    ++count;
+    auto const delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (value - mean);
+  }
+
+  /** @brief Fold the state of @p other into this state. */
+  void merge(Moments const &other) {
+    if (other.count == 0)
+      return;
+    auto const total = static_cast<double>(count + other.count);
+    auto const delta = other.mean - mean;
+    mean += delta * static_cast<double>(other.count) / total;
+    m2 += other.m2 + delta * delta * static_cast<double>(count) *
+                         static_cast<double>(other.count) / total;
+    count += other.count;
+  }
+
+  /** @brief The population variance of the values. */
+  double variance() const { return m2 / static_cast<double>(count); }
+
+  /** @brief Write the state as comma separated numbers. */
+  std::string encode() const {
+    std::string str = std::to_string(count) + ',';
+    detail::append_number(str, mean);
+    str += ',';
+    detail::append_number(str, m2);
+    return str;
+  }
+
+  /** @brief Read a state written by encode. */
+  bool decode(std::string_view str) {
+    std::vector<double> numbers;
+    if (not detail::parse_numbers(str, numbers) or numbers.size() != 3)
+      return false;
+    count = static_cast<std::size_t>(numbers[0]);
+    mean = numbers[1];
+    m2 = numbers[2];
+    return true;
+  }
+};
+
+/**
+ * @brief Merging t-digest estimating the quantiles of the values.
+ *
+ * The values are summarized by centroids, i.e. means with weights. Centroids
+ * near the median absorb many values, the ones in the tails only a few, so
+ * extreme quantiles like p99 stay accurate. The number of centroids is
+ * bounded by about the compression, small sets of values are kept exactly.
+ * NaNs are ignored.
+ */
+class QuantileSketch {
+public:
+  /** Bound of the number of centroids, larger is more accurate. */
+  static constexpr double compression = 100.0;
+
+  /** @brief Fold @p value into the state. */
+  void add(double value) {
+    if (std::isnan(value))
+      return;
+    m_buffer.push_back({value, 1.0});
+    if (m_buffer.size() >= buffer_capacity)
+      compress();
+  }
+
+  /** @brief Fold the state of @p other into this state. */
+  void merge(QuantileSketch const &other) {
+    // the extremes of the merged centroids are lost otherwise
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_buffer.insert(m_buffer.end(), other.m_centroids.begin(),
+                    other.m_centroids.end());
+    m_buffer.insert(m_buffer.end(), other.m_buffer.begin(),
+                    other.m_buffer.end());
+    compress();
+  }
+
+  /**
+   * @brief Estimate of the quantile @p q of the values.
+   *
+   * The value at rank q times the number of values, interpolated between
+   * the centroids. For few values this is the exact quantile, e.g. the
+   * median is the middle value or the mean of the middle two.
+   *
+   * @param q The quantile in [0, 1].
+   * @return The estimate or NaN if there are no values.
+   */
+  double quantile(double q) const {
+    auto sketch = *this;
+    sketch.compress();
+    auto const &centroids = sketch.m_centroids;
+    if (centroids.empty())
+      return std::numeric_limits<double>::quiet_NaN();
+    auto const target = q * sketch.m_weight;
+    // the center of a centroid is at the middle of its weight
+    auto center = centroids.front().weight / 2;
+    if (target <= center)
+      return interpolate(sketch.m_min, centroids.front().mean, 0.0, center,
+                         target);
+    for (std::size_t i = 0; i + 1 < centroids.size(); ++i) {
+      auto const next =
+          center + (centroids[i].weight + centroids[i + 1].weight) / 2;
+      if (target < next)
+        return interpolate(centroids[i].mean, centroids[i + 1].mean, center,
+                           next, target);
+      center = next;
+    }
+    return interpolate(centroids.back().mean, sketch.m_max, center,
+                       sketch.m_weight, target);
+  }
+
+  /** @brief Write the state as comma separated numbers. */
+  std::string encode() const {
+    auto sketch = *this;
+    sketch.compress();
+    std::string str;
+    detail::append_number(str, sketch.m_min);
+    str += ',';
+    detail::append_number(str, sketch.m_max);
+    for (auto const &centroid : sketch.m_centroids) {
+      str += ',';
+      detail::append_number(str, centroid.mean);
+      str += ',';
+      detail::append_number(str, centroid.weight);
+    }
+    return str;
+  }
+
+  /** @brief Read a state written by encode. */
+  bool decode(std::string_view str) {
+    std::vector<double> numbers;
+    if (not detail::parse_numbers(str, numbers) or numbers.size() < 2 or
+        numbers.size() % 2 != 0)
+      return false;
+    *this = {};
+    m_min = numbers[0];
+    m_max = numbers[1];
+    for (std::size_t i = 2; i < numbers.size(); i += 2) {
+      m_centroids.push_back({numbers[i], numbers[i + 1]});
+      m_weight += numbers[i + 1];
+    }
+    return true;
+  }
+
+private:
+  struct Centroid {
+    double mean;
+    double weight;
+  };
+
+  /** Number of values collected before they are merged into centroids. */
+  static constexpr std::size_t buffer_capacity =
+      static_cast<std::size_t>(5 * compression);
+
+  /**
+   * @brief The scale function, two centroids are merged if their joint
+   * weight spans at most one unit of it.
+   */
+  static double scale(double q) {
+    constexpr double pi = 3.14159265358979323846;
+    return compression / (2 * pi) * std::asin(std::min(2 * q - 1, 1.0));
+  }
+
+  static double interpolate(double low, double high, double low_rank,
+                            double high_rank, double rank) {
+    if (high_rank <= low_rank)
+      return low;
+    return low + (high - low) * (rank - low_rank) / (high_rank - low_rank);
+  }
+
+  /** @brief Merge the collected values into the centroids. */
+  void compress() {
+    if (m_buffer.empty())
+      return;
+    for (auto const &centroid : m_buffer) {
+      m_weight += centroid.weight;
+      m_min = std::min(m_min, centroid.mean);
+      m_max = std::max(m_max, centroid.mean);
+    }
+    m_buffer.insert(m_buffer.end(), m_centroids.begin(), m_centroids.end());
+    std::sort(m_buffer.begin(), m_buffer.end(),
+              [](auto const &a, auto const &b) { return a.mean < b.mean; });
+    m_centroids.clear();
+    auto current = m_buffer.front();
+    double weight_before = 0.0;
+    for (std::size_t i = 1; i < m_buffer.size(); ++i) {
+      auto const &next = m_buffer[i];
+      auto const merged = current.weight + next.weight;
+      if (scale((weight_before + merged) / m_weight) -
+              scale(weight_before / m_weight) <=
+          1.0) {
+        current.mean += (next.mean - current.mean) * next.weight / merged;
+        current.weight = merged;
+      } else {
+        weight_before += current.weight;
+        m_centroids.push_back(current);
+        current = next;
+      }
+    }
+    m_centroids.push_back(current);
+    m_buffer.clear();
+  }
+
+  /** The centroids, ascending by mean. */
+  std::vector<Centroid> m_centroids;
+  /** Values and centroids that are not merged yet. */
+  std::vector<Centroid> m_buffer;
+  /** Total weight of m_centroids. */
+  double m_weight = 0.0;
+  double m_min = std::numeric_limits<double>::infinity();
+  double m_max = -std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @brief HyperLogLog estimating the number of distinct values.
+ *
+ * The state is one byte per register, 4 KiB in total, and the standard
+ * error of the estimate is about 1.6%. Small counts are estimated by
+ * linear counting, which is nearly exact. NaNs are ignored and 0 and -0
+ * count as the same value.
+ */
+class DistinctCounter {
+public:
+  /** Number of bits of the hash that select the register. */
+  static constexpr unsigned precision = 12;
+  static constexpr std::size_t registers = std::size_t{1} << precision;
+
+  DistinctCounter() : m_registers(registers, 0) {}
+
+  /** @brief Fold @p value into the state. */
+  void add(double value) {
+    if (std::isnan(value))
+      return;
+    if (value == 0.0)
+      value = 0.0;
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    auto const hash = mix(bits);
+    auto const index = hash >> (64 - precision);
+    // the guard bit bounds the rank if the remaining bits are zero
+    auto const rest =
+        (hash << precision) | (std::uint64_t{1} << (precision - 1));
+    auto const rank = static_cast<std::uint8_t>(leading_zeros(rest) + 1);
+    m_registers[index] = std::max(m_registers[index], rank);
+  }
+
+  /** @brief Fold the state of @p other into this state. */
+  void merge(DistinctCounter const &other) {
+    for (std::size_t i = 0; i < registers; ++i)
+      m_registers[i] = std::max(m_registers[i], other.m_registers[i]);
+  }
+
+  /** @brief Estimate of the number of distinct values. */
+  double estimate() const {
+    auto const m = static_cast<double>(registers);
+    double inverse_sum = 0.0;
+    std::size_t zeros = 0;
+    for (auto const r : m_registers) {
+      inverse_sum += std::ldexp(1.0, -r);
+      zeros += r == 0;
+    }
+    auto const alpha = 0.7213 / (1.0 + 1.079 / m);
+    auto const raw = alpha * m * m / inverse_sum;
+    if (raw <= 2.5 * m and zeros != 0)
+      return m * std::log(m / static_cast<double>(zeros));
+    return raw;
+  }
+
+  /** @brief Write the registers as hexadecimal digits. */
+  std::string encode() const {
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string str;
+    str.reserve(2 * registers);
+    for (auto const r : m_registers) {
+      str += digits[r >> 4];
+      str += digits[r & 15];
+    }
+    return str;
+  }
+
+  /** @brief Read a state written by encode. */
+  bool decode(std::string_view str) {
+    if (str.size() != 2 * registers)
+      return false;
+    auto const digit = [](char c) {
+      return c >= '0' and c <= '9' ? c - '0'
+             : c >= 'a' and c <= 'f' ? c - 'a' + 10
+                                     : -1;
+    };
+    for (std::size_t i = 0; i < registers; ++i) {
+      auto const high = digit(str[2 * i]);
+      auto const low = digit(str[2 * i + 1]);
+      if (high < 0 or low < 0)
+        return false;
+      m_registers[i] = static_cast<std::uint8_t>(high * 16 + low);
+    }
+    return true;
+  }
+
+private:
+  /** @brief The finalizer of splitmix64, it spreads the bits evenly. */
+  static std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  static unsigned leading_zeros(std::uint64_t x) {
+#ifdef __GNUC__
+    return static_cast<unsigned>(__builtin_clzll(x));
+#else
+    unsigned n = 0;
+    for (auto bit = std::uint64_t{1} << 63; (x & bit) == 0; bit >>= 1)
+      ++n;
+    return n;
+#endif
+  }
+
+  std::vector<std::uint8_t> m_registers;
+};
+
+} // namespace Operation
+
+#endif
@@ -0,0 +1,159 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "stats.hpp"
+
+/** @file arena.hpp
+ *  @brief This file contains the bump allocator backing the XML documents.
+ */
+
+namespace XML {
+
+/**
+ * @brief Bump allocator handing out memory from a few large blocks.
+ *
+ * Objects are never freed individually, all memory is released at once when
+ * the arena is destroyed. Hence only trivially destructible types can be
+ * created in the arena. The block size doubles with every new block, so
+ * n bytes cost O(log n) allocations.
+ */
+class Arena {
+public:
+  static constexpr std::size_t initial_block_size = 64 * 1024;
+  static constexpr std::size_t max_block_size = 64 * 1024 * 1024;
+
+  Arena() = default;
+  Arena(Arena const &) = delete;
+  Arena &operator=(Arena const &) = delete;
+  Arena(Arena &&) = default;
+  Arena &operator=(Arena &&) = default;
+
+  /**
+   * @brief Allocate uninitialized memory.
+   *
+   * @param size Number of bytes.
+   * @param alignment Alignment of the memory, a power of two.
+   * @return Pointer to the memory, valid for the lifetime of the arena.
+   */
+  void *allocate(std::size_t size, std::size_t alignment) {
+    auto const address = reinterpret_cast<std::uintptr_t>(m_current);
+    auto padding = (alignment - address % alignment) % alignment;
+    if (m_current == nullptr or padding + size > m_remaining) {
+      add_block(size + alignment);
+      auto const block = reinterpret_cast<std::uintptr_t>(m_current);
+      padding = (alignment - block % alignment) % alignment;
+    }
+    auto const result = m_current + padding;
+    m_current = result + size;
+    m_remaining -= padding + size;
+    return result;
+  }
+
+  /**
+   * @brief Create an object in the arena.
+   *
+   * @param args Arguments the object is initialized with.
+   * @return Pointer to the object, valid for the lifetime of the arena.
+   */
+  template <class T, class... Args> T *create(Args &&...args) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "The arena does not run destructors");
+    return new (allocate(sizeof(T), alignof(T)))
+        T{std::forward<Args>(args)...};
+  }
+
+  /**
+   * @brief Allocate uninitialized memory for an array.
+   *
+   * @param size Number of elements.
+   * @return Pointer to the first element of the array.
+   */
+  template <class T> T *allocate_array(std::size_t size) {
+    static_assert(std::is_trivially_destructible_v<T>,
+                  "The arena does not run destructors");
+    return static_cast<T *>(allocate(size * sizeof(T), alignof(T)));
+  }
+
+  /**
+   * @brief Copy a string into the arena.
+   *
+   * @return A view of the copy, valid for the lifetime of the arena.
+   */
+  std::string_view copy(std::string_view str) {
+    if (str.empty())
+      return {};
+    auto const result = static_cast<char *>(allocate(str.size(), 1));
+    std::memcpy(result, str.data(), str.size());
+    return {result, str.size()};
+  }
+
+  /**
+   * @brief Take over the memory of @p other.
+   *
+   * Everything allocated in @p other stays valid for the lifetime of this
+   * arena, @p other is left empty.
+   */
+  void adopt(Arena &&other) {
+    std::move(other.m_blocks.begin(), other.m_blocks.end(),
+              std::back_inserter(m_blocks));
+    other.m_blocks.clear();
+    other.m_current = nullptr;
+    other.m_remaining = 0;
+  }
+
+  /** @brief Number of blocks requested from the system allocator. */
+  std::size_t block_count() const { return m_blocks.size(); }
+
+private:
+  void add_block(std::size_t min_size) {
+    auto const size = std::max(m_next_block_size, min_size);
+    YAXP_STATS_COUNT(arena_blocks, 1);
+    // not value initialized, the memory is only touched when it is used
+    m_blocks.emplace_back(new std::byte[size]);
+    m_current = m_blocks.back().get();
+    m_remaining = size;
+    m_next_block_size = std::min(2 * m_next_block_size, max_block_size);
+  }
+
+  std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+  std::byte *m_current = nullptr;
+  std::size_t m_remaining = 0;
+  std::size_t m_next_block_size = initial_block_size;
+};
+
+/**
+ * @brief Non-owning view of a contiguous array, e.g. one living in an Arena.
+ */
+template <class T> struct Span {
+  using value_type = T;
+  using iterator = T *;
+
+  T *m_data = nullptr;
+  std::size_t m_size = 0;
+
+  iterator begin() const { return m_data; }
+  iterator end() const { return m_data + m_size; }
+  std::size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  T &operator[](std::size_t ind) const {
+    assert(ind < m_size);
+    return m_data[ind];
+  }
+};
+
+} // namespace XML
+
+#endif
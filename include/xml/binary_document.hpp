@@ -0,0 +1,517 @@
+#ifndef BINARY_DOCUMENT_HPP
+#define BINARY_DOCUMENT_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parser.hpp"
+#include "symbols.hpp"
+
+/** @file binary_document.hpp
+ *  @brief This file contains a compact binary format of parsed documents.
+ */
+
+namespace XML {
+
+namespace binary {
+
+/** First bytes of every binary document. */
+constexpr char magic[8] = {'Y', 'A', 'X', 'P', 'Y', 'X', 'B', '\0'};
+/** Version of the layout, increased on every incompatible change. */
+constexpr std::uint32_t version = 1;
+/** Index of an element that does not exist. */
+constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+/**
+ * @brief Start of a binary document.
+ *
+ * All offsets are in bytes from the start of the document, every section is
+ * aligned to 8 bytes. The values are stored in the byte order of the
+ * writer, a reader with another byte order rejects the document.
+ */
+struct Header {
+  char magic[8];
+  std::uint32_t version;
+  /** Always 1, read with another byte order it is not. */
+  std::uint32_t byte_order;
+  /** Size of the file the document was parsed from. */
+  std::uint64_t source_size;
+  /** Modification time of the file the document was parsed from. */
+  std::int64_t source_time;
+  std::uint64_t element_count;
+  std::uint64_t elements;
+  std::uint64_t attribute_count;
+  std::uint64_t attributes;
+  std::uint64_t symbol_count;
+  std::uint64_t symbols;
+  std::uint64_t strings_size;
+  std::uint64_t strings;
+};
+
+/**
+ * @brief An element, the elements are stored in the order they are closed.
+ *
+ * Parent, children and siblings are indices of this order.
+ */
+struct Element {
+  Symbol symbol;
+  std::uint32_t parent;
+  std::uint32_t first_child;
+  std::uint32_t next_sibling;
+  std::uint32_t nesting_level;
+  std::uint32_t attribute_count;
+  /** Index of the first attribute of the element. */
+  std::uint64_t first_attribute;
+  /** Position of the content in the strings. */
+  std::uint64_t content;
+  std::uint64_t content_size;
+};
+
+struct Attribute {
+  Symbol key_symbol;
+  std::uint32_t value_size;
+  /** Position of the value in the strings. */
+  std::uint64_t value;
+};
+
+/** @brief Name of a symbol, the symbols are stored in order. */
+struct Name {
+  std::uint64_t position;
+  std::uint64_t size;
+};
+
+} // namespace binary
+
+/**
+ * @brief Write @p doc in the binary format.
+ *
+ * Names are stored once in the symbol table, the contents and values are
+ * stored in one string section and all links are indices, so the result can
+ * be used as it is, e.g. memory mapped, by a BinaryDocument.
+ *
+ * @param doc The document. Links to elements that are not part of it, e.g.
+ * the parents in a filtered document, are not stored.
+ * @param output Binary stream to write the document to.
+ * @param source_size, source_time Size and modification time of the file
+ * the document was parsed from, they let readers check if it is up to date.
+ * @throws std::runtime_error If the document is too large or writing fails.
+ */
+inline void write_binary(XML_Doc const &doc, std::ostream &output,
+                         std::uint64_t source_size = 0,
+                         std::int64_t source_time = 0) {
+  if (doc.size() >= binary::none)
+    throw std::runtime_error("Too many elements");
+  std::unordered_map<XML_Element const *, std::uint32_t> indices;
+  indices.reserve(doc.size());
+  for (std::size_t i = 0; i < doc.size(); ++i)
+    indices.emplace(doc[i], static_cast<std::uint32_t>(i));
+  auto const index = [&indices](XML_Element const *elem) {
+    auto const it = indices.find(elem);
+    return it != indices.end() ? it->second : binary::none;
+  };
+
+  std::string strings;
+  auto const add_string = [&strings](std::string_view str) {
+    auto const position = strings.size();
+    strings.append(str);
+    return static_cast<std::uint64_t>(position);
+  };
+
+  auto const &symbols = *doc.m_symbols;
+  std::vector<binary::Name> names;
+  names.reserve(symbols.size());
+  for (Symbol s = 0; s < symbols.size(); ++s) {
+    auto const name = symbols.name(s);
+    names.push_back({add_string(name), name.size()});
+  }
+
+  std::vector<binary::Element> elements;
+  std::vector<binary::Attribute> attributes;
+  elements.reserve(doc.size());
+  for (auto const elem : doc) {
+    elements.push_back(
+        {elem->symbol, index(elem->parent), index(elem->first_child),
+         index(elem->next_sibling),
+         static_cast<std::uint32_t>(elem->nesting_level),
+         static_cast<std::uint32_t>(elem->attributes.size()),
+         attributes.size(), add_string(elem->content),
+         elem->content.size()});
+    for (auto const &attr : elem->attributes) {
+      auto const value = attr.key_val.second;
+      if (value.size() > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("Attribute value too long");
+      attributes.push_back({attr.key_symbol,
+                            static_cast<std::uint32_t>(value.size()),
+                            add_string(value)});
+    }
+  }
+
+  auto const aligned = [](std::uint64_t offset) {
+    return (offset + 7) / 8 * 8;
+  };
+  binary::Header header{};
+  std::memcpy(header.magic, binary::magic, sizeof(header.magic));
+  header.version = binary::version;
+  header.byte_order = 1;
+  header.source_size = source_size;
+  header.source_time = source_time;
+  header.element_count = elements.size();
+  header.elements = aligned(sizeof(header));
+  header.attribute_count = attributes.size();
+  header.attributes = aligned(header.elements +
+                              elements.size() * sizeof(binary::Element));
+  header.symbol_count = names.size();
+  header.symbols = aligned(header.attributes +
+                           attributes.size() * sizeof(binary::Attribute));
+  header.strings_size = strings.size();
+  header.strings =
+      aligned(header.symbols + names.size() * sizeof(binary::Name));
+
+  std::uint64_t written = 0;
+  auto const write = [&output, &written](void const *data, std::size_t size,
+                                         std::uint64_t offset) {
+    static constexpr char padding[8] = {};
+    output.write(padding, static_cast<std::streamsize>(offset - written));
+    output.write(static_cast<char const *>(data),
+                 static_cast<std::streamsize>(size));
+    written = offset + size;
+  };
+  write(&header, sizeof(header), 0);
+  write(elements.data(), elements.size() * sizeof(binary::Element),
+        header.elements);
+  write(attributes.data(), attributes.size() * sizeof(binary::Attribute),
+        header.attributes);
+  write(names.data(), names.size() * sizeof(binary::Name), header.symbols);
+  write(strings.data(), strings.size(), header.strings);
+  if (not output)
+    throw std::runtime_error("Could not write the binary document");
+}
+
+class BinaryDocument;
+
+/**
+ * @brief Handle of an element of a BinaryDocument.
+ *
+ * The handle reads the element from the buffer of the document, it is only
+ * valid as long as the document.
+ */
+class BinaryElement {
+public:
+  /**
+   * @brief Forward range over the children of an element.
+   */
+  struct Children {
+    struct iterator {
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = BinaryElement;
+      using difference_type = std::ptrdiff_t;
+      using pointer = BinaryElement const *;
+      using reference = BinaryElement;
+
+      BinaryDocument const *m_doc;
+      std::uint32_t m_index;
+
+      BinaryElement operator*() const { return {m_doc, m_index}; }
+      iterator &operator++();
+      iterator operator++(int) {
+        auto const old = *this;
+        ++*this;
+        return old;
+      }
+      bool operator==(iterator const &other) const {
+        return m_index == other.m_index;
+      }
+      bool operator!=(iterator const &other) const {
+        return m_index != other.m_index;
+      }
+    };
+
+    BinaryDocument const *m_doc;
+    std::uint32_t m_first;
+
+    iterator begin() const { return {m_doc, m_first}; }
+    iterator end() const { return {m_doc, binary::none}; }
+    bool empty() const { return m_first == binary::none; }
+  };
+
+  BinaryElement(BinaryDocument const *doc, std::uint32_t index)
+      : m_doc(doc), m_index(index) {}
+
+  /** @brief Position of the element in the document. */
+  std::uint32_t index() const { return m_index; }
+
+  std::string_view name() const;
+  Symbol symbol() const;
+  std::size_t nesting_level() const;
+  /** @brief Whether the element has a parent. */
+  bool has_parent() const;
+  BinaryElement parent() const;
+  Children children() const;
+  std::string_view content() const;
+
+  /** @brief All attributes in the order of the start tag. */
+  std::vector<std::pair<std::string_view, std::string_view>>
+  attributes() const;
+
+  /** @brief The value of the attribute @p attr_name or an empty view. */
+  std::string_view get_attribute(std::string_view attr_name) const;
+
+  /** @brief The value of the attribute with key @p key or an empty view. */
+  std::string_view get_attribute(Symbol key) const;
+
+  /**
+   * @brief The first child named @p child_name.
+   *
+   * @throws std::runtime_error If there is no such child.
+   */
+  BinaryElement get_child(std::string_view child_name) const;
+
+  /** @copydoc get_child */
+  BinaryElement get_child(Symbol child_name) const;
+
+  bool operator==(BinaryElement const &other) const {
+    return m_doc == other.m_doc and m_index == other.m_index;
+  }
+  bool operator!=(BinaryElement const &other) const {
+    return not(*this == other);
+  }
+
+private:
+  binary::Element const &node() const;
+
+  BinaryDocument const *m_doc;
+  std::uint32_t m_index;
+};
+
+/**
+ * @brief Read-only view of a document in the binary format.
+ *
+ * Opening the document only checks the header and the section bounds, so it
+ * takes the same time for every size. The elements, attributes and strings
+ * are read from the buffer in place and every element is checked when it is
+ * read. The buffer, e.g. a MappedFile, has to outlive the document and has
+ * to be aligned to 8 bytes.
+ */
+class BinaryDocument {
+public:
+  /**
+   * @brief Open the binary document in @p buffer.
+   *
+   * @throws std::runtime_error If @p buffer is no valid binary document of
+   * this version. Invalid elements are reported when they are read.
+   */
+  explicit BinaryDocument(std::string_view buffer) : m_buffer(buffer) {
+    if (buffer.size() < sizeof(binary::Header) or
+        reinterpret_cast<std::uintptr_t>(buffer.data()) % 8 != 0)
+      throw std::runtime_error("Invalid binary document");
+    m_header = reinterpret_cast<binary::Header const *>(buffer.data());
+    if (std::memcmp(m_header->magic, binary::magic, sizeof(binary::magic)) !=
+            0 or
+        m_header->version != binary::version or m_header->byte_order != 1)
+      throw std::runtime_error("Invalid binary document");
+    m_elements = section<binary::Element>(m_header->elements,
+                                          m_header->element_count);
+    m_attributes = section<binary::Attribute>(m_header->attributes,
+                                              m_header->attribute_count);
+    m_names =
+        section<binary::Name>(m_header->symbols, m_header->symbol_count);
+    m_strings = section<char>(m_header->strings, m_header->strings_size);
+  }
+
+  BinaryDocument(BinaryDocument const &) = delete;
+  BinaryDocument &operator=(BinaryDocument const &) = delete;
+
+  /** @brief Number of elements. */
+  std::size_t size() const { return m_header->element_count; }
+
+  /** @brief The @p ind-th closed element, like XML_Doc::operator[]. */
+  BinaryElement operator[](std::size_t ind) const {
+    assert(ind < size());
+    return {this, static_cast<std::uint32_t>(ind)};
+  }
+
+  /** @brief The last closed element, i.e. the root. */
+  BinaryElement back() const { return (*this)[size() - 1]; }
+
+  /**
+   * @brief Table of the names, the symbols are the ones of the elements.
+   *
+   * The table is built on first use, the elements do not need it.
+   *
+   * @throws std::runtime_error If names are stored more than once.
+   */
+  SymbolTable const &symbols() const {
+    std::call_once(m_symbols_built, [this] {
+      for (std::uint64_t s = 0; s < m_header->symbol_count; ++s)
+        m_symbols.intern(name(static_cast<Symbol>(s)));
+    });
+    if (m_symbols.size() != m_header->symbol_count)
+      throw std::runtime_error("Invalid binary document");
+    return m_symbols;
+  }
+
+  std::uint64_t source_size() const { return m_header->source_size; }
+  std::int64_t source_time() const { return m_header->source_time; }
+
+private:
+  friend class BinaryElement;
+
+  /** @brief The @p count objects of type T at @p offset. */
+  template <class T>
+  T const *section(std::uint64_t offset, std::uint64_t count) const {
+    if (offset % alignof(T) != 0 or offset > m_buffer.size() or
+        count > (m_buffer.size() - offset) / sizeof(T))
+      throw std::runtime_error("Invalid binary document");
+    return reinterpret_cast<T const *>(m_buffer.data() + offset);
+  }
+
+  std::string_view string(std::uint64_t position, std::uint64_t size) const {
+    if (position > m_header->strings_size or
+        size > m_header->strings_size - position)
+      throw std::runtime_error("Invalid binary document");
+    return {m_strings + position, size};
+  }
+
+  /** @brief The name of @p symbol, read from the strings. */
+  std::string_view name(Symbol symbol) const {
+    if (symbol >= m_header->symbol_count)
+      throw std::runtime_error("Invalid binary document");
+    return string(m_names[symbol].position, m_names[symbol].size);
+  }
+
+  /**
+   * @brief The element at @p index after checking its symbol, attribute
+   * range and links.
+   *
+   * Children are closed before and parents and next siblings after an
+   * element, so following the links always terminates.
+   */
+  binary::Element const &element(std::uint32_t index) const {
+    auto const count = m_header->element_count;
+    if (index >= count)
+      throw std::runtime_error("Invalid binary document");
+    auto const &elem = m_elements[index];
+    auto const closed_after = [index, count](std::uint32_t other) {
+      return other == binary::none or (other > index and other < count);
+    };
+    if (elem.symbol >= m_header->symbol_count or
+        elem.first_attribute > m_header->attribute_count or
+        elem.attribute_count >
+            m_header->attribute_count - elem.first_attribute or
+        not closed_after(elem.parent) or not closed_after(elem.next_sibling) or
+        (elem.first_child != binary::none and elem.first_child >= index))
+      throw std::runtime_error("Invalid binary document");
+    return elem;
+  }
+
+  std::string_view m_buffer;
+  binary::Header const *m_header = nullptr;
+  binary::Element const *m_elements = nullptr;
+  binary::Attribute const *m_attributes = nullptr;
+  binary::Name const *m_names = nullptr;
+  char const *m_strings = nullptr;
+  mutable SymbolTable m_symbols;
+  mutable std::once_flag m_symbols_built;
+};
+
+inline BinaryElement::Children::iterator &
+BinaryElement::Children::iterator::operator++() {
+  m_index = m_doc->element(m_index).next_sibling;
+  return *this;
+}
+
+inline binary::Element const &BinaryElement::node() const {
+  return m_doc->element(m_index);
+}
+
+inline std::string_view BinaryElement::name() const {
+  return m_doc->name(node().symbol);
+}
+
+inline Symbol BinaryElement::symbol() const { return node().symbol; }
+
+inline std::size_t BinaryElement::nesting_level() const {
+  return node().nesting_level;
+}
+
+inline bool BinaryElement::has_parent() const {
+  return node().parent != binary::none;
+}
+
+inline BinaryElement BinaryElement::parent() const {
+  return {m_doc, node().parent};
+}
+
+inline BinaryElement::Children BinaryElement::children() const {
+  return {m_doc, node().first_child};
+}
+
+inline std::string_view BinaryElement::content() const {
+  return m_doc->string(node().content, node().content_size);
+}
+
+inline std::vector<std::pair<std::string_view, std::string_view>>
+BinaryElement::attributes() const {
+  std::vector<std::pair<std::string_view, std::string_view>> result;
+  auto const &elem = node();
+  for (std::uint32_t i = 0; i < elem.attribute_count; ++i) {
+    auto const &attr = m_doc->m_attributes[elem.first_attribute + i];
+    result.emplace_back(m_doc->name(attr.key_symbol),
+                        m_doc->string(attr.value, attr.value_size));
+  }
+  return result;
+}
+
+inline std::string_view
+BinaryElement::get_attribute(std::string_view attr_name) const {
+  auto const &elem = node();
+  for (std::uint32_t i = 0; i < elem.attribute_count; ++i) {
+    auto const &attr = m_doc->m_attributes[elem.first_attribute + i];
+    if (m_doc->name(attr.key_symbol) == attr_name)
+      return m_doc->string(attr.value, attr.value_size);
+  }
+  return {};
+}
+
+inline std::string_view BinaryElement::get_attribute(Symbol key) const {
+  auto const &elem = node();
+  for (std::uint32_t i = 0; i < elem.attribute_count; ++i) {
+    auto const &attr = m_doc->m_attributes[elem.first_attribute + i];
+    if (attr.key_symbol == key)
+      return m_doc->string(attr.value, attr.value_size);
+  }
+  return {};
+}
+
+inline BinaryElement
+BinaryElement::get_child(std::string_view child_name) const {
+  for (auto const child : children()) {
+    if (child.name() == child_name)
+      return child;
+  }
+  throw std::runtime_error("Child not found");
+}
+
+inline BinaryElement BinaryElement::get_child(Symbol child_name) const {
+  for (auto const child : children()) {
+    if (child.symbol() == child_name)
+      return child;
+  }
+  throw std::runtime_error("Child not found");
+}
+
+} // namespace XML
+
+#endif
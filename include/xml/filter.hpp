@@ -0,0 +1,467 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/** @file filter.hpp
+ *  @brief This file contains the compiled filter predicates.
+ */
+
+namespace XML {
+
+namespace detail {
+
+/** Set of bytes a regex atom matches. */
+using ByteSet = std::bitset<256>;
+
+/**
+ * @brief Deterministic automaton matching the entire input.
+ *
+ * State 0 is the dead state, state 1 the start state.
+ */
+struct Dfa {
+  static constexpr std::uint32_t dead = 0;
+  static constexpr std::uint32_t start = 1;
+
+  /** Transitions, 256 per state. */
+  std::vector<std::uint32_t> transitions;
+  std::vector<bool> accepting;
+
+  bool match(std::string_view value) const {
+    auto state = start;
+    for (auto const c : value) {
+      state = transitions[256 * state + static_cast<unsigned char>(c)];
+      if (state == dead)
+        return false;
+    }
+    return accepting[state];
+  }
+};
+
+/**
+ * @brief Thompson NFA for a subset of the ECMAScript regex grammar.
+ *
+ * Supported are literals, escapes, '.', bracket expressions, \\d, \\w, \\s
+ * and their negations, groups, '|', '*', '+' and '?'. Anything else, e.g.
+ * anchors, bounded repetitions or back references, makes the constructor
+ * throw std::invalid_argument so that the caller can fall back to
+ * std::regex.
+ */
+class Nfa {
+public:
+  struct State {
+    ByteSet chars;
+    std::size_t next = 0;
+    std::vector<std::size_t> epsilon;
+  };
+
+  explicit Nfa(std::string_view pattern) : m_pattern(pattern) {
+    auto const fragment = parse_alternative();
+    if (m_pos != m_pattern.size())
+      unsupported();
+    m_start = fragment.first;
+    m_accept = fragment.second;
+  }
+
+  std::vector<State> const &states() const { return m_states; }
+  std::size_t start() const { return m_start; }
+  std::size_t accept() const { return m_accept; }
+
+private:
+  /** Start and end state of a part of the automaton. */
+  using Fragment = std::pair<std::size_t, std::size_t>;
+
+  [[noreturn]] static void unsupported() {
+    throw std::invalid_argument("Unsupported regex");
+  }
+
+  std::size_t add_state() {
+    m_states.emplace_back();
+    return m_states.size() - 1;
+  }
+
+  Fragment add_chars(ByteSet const &chars) {
+    auto const begin = add_state();
+    auto const end = add_state();
+    m_states[begin].chars = chars;
+    m_states[begin].next = end;
+    return {begin, end};
+  }
+
+  bool at(char c) const {
+    return m_pos < m_pattern.size() and m_pattern[m_pos] == c;
+  }
+
+  Fragment parse_alternative() {
+    auto fragment = parse_concatenation();
+    while (at('|')) {
+      ++m_pos;
+      auto const other = parse_concatenation();
+      auto const begin = add_state();
+      auto const end = add_state();
+      m_states[begin].epsilon = {fragment.first, other.first};
+      m_states[fragment.second].epsilon.push_back(end);
+      m_states[other.second].epsilon.push_back(end);
+      fragment = {begin, end};
+    }
+    return fragment;
+  }
+
+  Fragment parse_concatenation() {
+    auto const begin = add_state();
+    Fragment fragment{begin, begin};
+    while (m_pos < m_pattern.size() and not at('|') and not at(')')) {
+      auto const next = parse_repetition();
+      m_states[fragment.second].epsilon.push_back(next.first);
+      fragment.second = next.second;
+    }
+    return fragment;
+  }
+
+  Fragment parse_repetition() {
+    auto fragment = parse_atom();
+    while (at('*') or at('+') or at('?')) {
+      auto const op = m_pattern[m_pos++];
+      if (at('?'))
+        ++m_pos; // lazy quantifiers match the same language
+      auto const begin = add_state();
+      auto const end = add_state();
+      m_states[begin].epsilon.push_back(fragment.first);
+      if (op != '+')
+        m_states[begin].epsilon.push_back(end);
+      if (op != '?')
+        m_states[fragment.second].epsilon.push_back(fragment.first);
+      m_states[fragment.second].epsilon.push_back(end);
+      fragment = {begin, end};
+    }
+    return fragment;
+  }
+
+  Fragment parse_atom() {
+    auto const c = m_pattern[m_pos++];
+    switch (c) {
+    case '(': {
+      if (at('?')) {
+        // only non-capturing groups
+        if (m_pos + 1 >= m_pattern.size() or m_pattern[m_pos + 1] != ':')
+          unsupported();
+        m_pos += 2;
+      }
+      auto const fragment = parse_alternative();
+      if (not at(')'))
+        unsupported();
+      ++m_pos;
+      return fragment;
+    }
+    case '.': {
+      ByteSet chars;
+      chars.set();
+      chars.reset('\n');
+      chars.reset('\r');
+      return add_chars(chars);
+    }
+    case '[':
+      return add_chars(parse_bracket());
+    case '\\':
+      return add_chars(parse_escape());
+    case '^':
+    case '$':
+    case '{':
+    case '}':
+    case ')':
+    case ']':
+    case '*':
+    case '+':
+    case '?':
+      unsupported();
+    default: {
+      ByteSet chars;
+      chars.set(static_cast<unsigned char>(c));
+      return add_chars(chars);
+    }
+    }
+  }
+
+  ByteSet parse_escape() {
+    if (m_pos >= m_pattern.size())
+      unsupported();
+    auto const c = m_pattern[m_pos++];
+    ByteSet chars;
+    auto const add_range = [&chars](char first, char last) {
+      for (auto i = static_cast<unsigned char>(first);
+           i <= static_cast<unsigned char>(last); ++i)
+        chars.set(i);
+    };
+    switch (c) {
+    case 'd':
+    case 'D':
+      add_range('0', '9');
+      break;
+    case 'w':
+    case 'W':
+      add_range('0', '9');
+      add_range('A', 'Z');
+      add_range('a', 'z');
+      chars.set('_');
+      break;
+    case 's':
+    case 'S':
+      add_range('\t', '\r');
+      chars.set(' ');
+      break;
+    case 't':
+      chars.set('\t');
+      break;
+    case 'n':
+      chars.set('\n');
+      break;
+    case 'r':
+      chars.set('\r');
+      break;
+    default:
+      // only escaped punctuation is taken literally
+      if (std::isalnum(static_cast<unsigned char>(c)))
+        unsupported();
+      chars.set(static_cast<unsigned char>(c));
+      return chars;
+    }
+    if (std::isupper(static_cast<unsigned char>(c)))
+      chars.flip();
+    return chars;
+  }
+
+  ByteSet parse_bracket() {
+    ByteSet chars;
+    auto const negated = at('^');
+    if (negated)
+      ++m_pos;
+    while (not at(']')) {
+      if (m_pos >= m_pattern.size() or at('['))
+        unsupported();
+      if (at('\\')) {
+        ++m_pos;
+        chars |= parse_escape();
+        continue;
+      }
+      auto const first = static_cast<unsigned char>(m_pattern[m_pos++]);
+      auto last = first;
+      if (at('-') and m_pos + 1 < m_pattern.size() and
+          m_pattern[m_pos + 1] != ']') {
+        last = static_cast<unsigned char>(m_pattern[m_pos + 1]);
+        m_pos += 2;
+        if (last < first or last == '\\')
+          unsupported();
+      }
+      for (auto i = static_cast<unsigned>(first); i <= last; ++i)
+        chars.set(i);
+    }
+    ++m_pos;
+    return negated ? ~chars : chars;
+  }
+
+  std::string_view m_pattern;
+  std::size_t m_pos = 0;
+  std::vector<State> m_states;
+  std::size_t m_start = 0;
+  std::size_t m_accept = 0;
+};
+
+/**
+ * @brief Turn a NFA into a DFA by subset construction.
+ *
+ * @param nfa The automaton to convert.
+ * @param max_states Limit of DFA states.
+ * @return The DFA or an empty optional if it would exceed @p max_states.
+ */
+inline std::optional<Dfa> make_dfa(Nfa const &nfa,
+                                   std::size_t max_states = 1024) {
+  auto const &states = nfa.states();
+  // shared by all closures, only the states of a result are reset
+  std::vector<bool> seen(states.size());
+  auto const closure = [&states, &seen](std::vector<std::size_t> const &set,
+                                        std::vector<std::size_t> &result) {
+    result.clear();
+    for (auto const s : set) {
+      if (not seen[s]) {
+        seen[s] = true;
+        result.push_back(s);
+      }
+    }
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      for (auto const next : states[result[i]].epsilon) {
+        if (not seen[next]) {
+          seen[next] = true;
+          result.push_back(next);
+        }
+      }
+    }
+    for (auto const s : result)
+      seen[s] = false;
+    std::sort(result.begin(), result.end());
+  };
+
+  Dfa dfa;
+  std::map<std::vector<std::size_t>, std::uint32_t> ids;
+  // scratch buffers reused for every transition
+  std::vector<std::size_t> next;
+  std::vector<std::size_t> subset;
+  closure({nfa.start()}, subset);
+  std::vector<std::vector<std::size_t>> subsets = {{}, subset};
+  ids[subsets[0]] = Dfa::dead;
+  ids[subsets[1]] = Dfa::start;
+  for (std::size_t id = 0; id < subsets.size(); ++id) {
+    if (subsets.size() > max_states)
+      return std::nullopt;
+    dfa.accepting.push_back(std::binary_search(
+        subsets[id].begin(), subsets[id].end(), nfa.accept()));
+    dfa.transitions.resize(256 * (id + 1), Dfa::dead);
+    if (subsets[id].empty())
+      continue;
+    for (std::size_t c = 0; c < 256; ++c) {
+      next.clear();
+      for (auto const s : subsets[id]) {
+        if (states[s].chars.test(c))
+          next.push_back(states[s].next);
+      }
+      if (next.empty())
+        continue;
+      closure(next, subset);
+      auto const it = ids.find(subset);
+      if (it != ids.end()) {
+        dfa.transitions[256 * id + c] = it->second;
+      } else {
+        auto const new_id = static_cast<std::uint32_t>(subsets.size());
+        ids.emplace(subset, new_id);
+        subsets.push_back(subset);
+        dfa.transitions[256 * id + c] = new_id;
+      }
+    }
+  }
+  return dfa;
+}
+
+/** @brief Whether @p pattern has no regex meta characters. */
+inline bool is_literal(std::string_view pattern) {
+  return pattern.find_first_of("\\^$.|?*+()[]{}") == std::string_view::npos;
+}
+
+} // namespace detail
+
+/**
+ * @brief Compiled predicate matching a string against a regex.
+ *
+ * The predicate gives the same results as std::regex_match with the default
+ * ECMAScript grammar. Common shapes of patterns, "L", "L.*", ".*L" and
+ * ".*L.*" with a literal L, are turned into plain string operations, other
+ * patterns into a DFA. Only patterns the DFA construction does not support
+ * are matched by std::regex. Compiled filters are cheap to copy.
+ */
+class Filter {
+public:
+  enum class Kind { literal, prefix, suffix, contains, dfa, regex };
+
+  /** @brief The empty pattern, it only matches the empty string. */
+  Filter() = default;
+
+  /**
+   * @brief Compile @p pattern.
+   *
+   * @throws std::regex_error If the pattern is not a valid regex.
+   */
+  explicit Filter(std::string_view pattern) {
+    auto const size = pattern.size();
+    auto const wildcard = [pattern](std::size_t pos) {
+      return pattern.substr(pos, 2) == ".*" and
+             (pos + 2 == pattern.size() or
+              (pattern[pos + 2] != '?' and pattern[pos + 2] != '*' and
+               pattern[pos + 2] != '+'));
+    };
+    if (detail::is_literal(pattern)) {
+      m_kind = Kind::literal;
+      m_literal = pattern;
+    } else if (size >= 4 and wildcard(0) and wildcard(size - 2) and
+               detail::is_literal(pattern.substr(2, size - 4))) {
+      m_kind = Kind::contains;
+      m_literal = pattern.substr(2, size - 4);
+    } else if (size >= 2 and wildcard(size - 2) and
+               detail::is_literal(pattern.substr(0, size - 2))) {
+      m_kind = Kind::prefix;
+      m_literal = pattern.substr(0, size - 2);
+    } else if (size >= 2 and wildcard(0) and
+               detail::is_literal(pattern.substr(2))) {
+      m_kind = Kind::suffix;
+      m_literal = pattern.substr(2);
+    } else {
+      compile(pattern);
+    }
+  }
+
+  Kind kind() const { return m_kind; }
+
+  /** @brief Whether @p value matches the pattern entirely. */
+  bool operator()(std::string_view value) const {
+    // '.' does not match line terminators
+    auto const no_terminator = [](std::string_view rest) {
+      return rest.find_first_of("\n\r") == std::string_view::npos;
+    };
+    auto const literal_size = m_literal.size();
+    switch (m_kind) {
+    case Kind::literal:
+      return value == m_literal;
+    case Kind::prefix:
+      return value.substr(0, literal_size) == m_literal and
+             no_terminator(value.substr(literal_size));
+    case Kind::suffix:
+      return value.size() >= literal_size and
+             value.substr(value.size() - literal_size) == m_literal and
+             no_terminator(value.substr(0, value.size() - literal_size));
+    case Kind::contains:
+      return value.find(m_literal) != std::string_view::npos and
+             no_terminator(value);
+    case Kind::dfa:
+      return m_dfa->match(value);
+    case Kind::regex:
+      return std::regex_match(value.begin(), value.end(), *m_regex);
+    }
+    return false;
+  }
+
+private:
+  void compile(std::string_view pattern) {
+    // validates the pattern and reports errors like std::regex does
+    auto regex = std::make_shared<std::regex const>(pattern.begin(),
+                                                    pattern.end());
+    try {
+      if (auto dfa = detail::make_dfa(detail::Nfa(pattern))) {
+        m_kind = Kind::dfa;
+        m_dfa = std::make_shared<detail::Dfa const>(std::move(*dfa));
+        return;
+      }
+    } catch (std::invalid_argument const &) {
+    }
+    m_kind = Kind::regex;
+    m_regex = std::move(regex);
+  }
+
+  Kind m_kind = Kind::literal;
+  std::string m_literal;
+  std::shared_ptr<detail::Dfa const> m_dfa;
+  std::shared_ptr<std::regex const> m_regex;
+};
+
+} // namespace XML
+
+#endif
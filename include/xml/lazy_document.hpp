@@ -0,0 +1,408 @@
+#ifndef LAZY_DOCUMENT_HPP
+#define LAZY_DOCUMENT_HPP
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "filter.hpp"
+#include "lexer.hpp"
+#include "scanner.hpp"
+
+/** @file lazy_document.hpp
+ *  @brief This file contains a XML document that is decoded on demand.
+ */
+
+namespace XML {
+
+class LazyDocument;
+
+/**
+ * @brief Handle of an element of a LazyDocument.
+ *
+ * Nothing but the position of the element in the buffer and its links are
+ * stored, name, attributes and content are decoded from the buffer whenever
+ * they are asked for. Handles are only valid as long as their document.
+ */
+class LazyElement {
+public:
+  /**
+   * @brief Forward range over the children of an element.
+   */
+  struct Children {
+    struct iterator {
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = LazyElement;
+      using difference_type = std::ptrdiff_t;
+      using pointer = LazyElement const *;
+      using reference = LazyElement;
+
+      LazyDocument const *m_doc;
+      std::uint32_t m_index;
+
+      LazyElement operator*() const { return {m_doc, m_index}; }
+      iterator &operator++();
+      iterator operator++(int) {
+        auto const old = *this;
+        ++*this;
+        return old;
+      }
+      bool operator==(iterator const &other) const {
+        return m_index == other.m_index;
+      }
+      bool operator!=(iterator const &other) const {
+        return m_index != other.m_index;
+      }
+    };
+
+    LazyDocument const *m_doc;
+    std::uint32_t m_first;
+
+    iterator begin() const { return {m_doc, m_first}; }
+    iterator end() const;
+    bool empty() const { return begin() == end(); }
+  };
+
+  LazyElement(LazyDocument const *doc, std::uint32_t index)
+      : m_doc(doc), m_index(index) {}
+
+  /** @brief Position of the element in the document, in start tag order. */
+  std::uint32_t index() const { return m_index; }
+
+  std::string_view name() const;
+  std::size_t nesting_level() const;
+  /** @brief Whether the element has a parent. */
+  bool has_parent() const;
+  LazyElement parent() const;
+  Children children() const;
+
+  /**
+   * @brief The content following the start tag.
+   *
+   * Like the StringLexer the content is only recognized if it starts with an
+   * alphanumeric char and its whitespace is skipped. Contents with
+   * whitespace inside are copied without it into the document once.
+   */
+  std::string_view content() const;
+
+  /** @brief All attributes in the order of the start tag. */
+  std::vector<std::pair<std::string_view, std::string_view>>
+  attributes() const;
+
+  /** @brief The value of the attribute @p attr_name or an empty view. */
+  std::string_view get_attribute(std::string_view attr_name) const;
+
+  /**
+   * @brief The values of the attributes @p attr_names, decoded in a single
+   * scan of the start tag.
+   *
+   * @param attr_names The names of the wanted attributes.
+   * @param values Set to the value of each name or an empty view.
+   */
+  void get_attributes(std::vector<std::string_view> const &attr_names,
+                      std::vector<std::string_view> &values) const;
+
+  /**
+   * @brief The first child named @p child_name.
+   *
+   * @throws std::runtime_error If there is no such child.
+   */
+  LazyElement get_child(std::string_view child_name) const;
+
+  bool operator==(LazyElement const &other) const {
+    return m_doc == other.m_doc and m_index == other.m_index;
+  }
+  bool operator!=(LazyElement const &other) const {
+    return not(*this == other);
+  }
+
+private:
+  LazyDocument const *m_doc;
+  std::uint32_t m_index;
+};
+
+/**
+ * @brief XML document that is decoded on demand.
+ *
+ * Constructing the document makes a single pass over the buffer which only
+ * records where the start tags are and how the elements are nested, at
+ * about 40 bytes per element. Names, attributes and contents stay in the
+ * buffer and are decoded when they are asked for, so the cost of a query
+ * depends on the data it touches instead of the size of the document. The
+ * elements are recognized like the StringLexer does, processing
+ * instructions and comments are skipped. The buffer has to outlive the
+ * document.
+ */
+class LazyDocument {
+public:
+  static constexpr std::uint32_t none =
+      std::numeric_limits<std::uint32_t>::max();
+
+  /**
+   * @brief Record the structure of the document in @p buffer.
+   *
+   * @param buffer The document, e.g. a memory mapped file.
+   */
+  explicit LazyDocument(std::string_view buffer) : m_buffer(buffer) {
+    StructuralIndex index(buffer);
+    std::vector<std::uint32_t> open;
+    auto const size = buffer.size();
+    std::size_t pos = 0;
+    while ((pos = index.find(pos, &BlockMasks::lt)) < size) {
+      auto const next = pos + 1 < size ? buffer[pos + 1] : '\0';
+      if (detail::is_alpha(next)) {
+        auto const tag_end = find_tag_end(pos + 1);
+        auto const elem = static_cast<std::uint32_t>(m_nodes.size());
+        auto const parent = open.empty() ? none : open.back();
+        m_nodes.push_back({pos, tag_end, parent, none, none, none,
+                           static_cast<std::uint32_t>(open.size())});
+        if (parent != none) {
+          auto &p = m_nodes[parent];
+          if (p.last_child != none)
+            m_nodes[p.last_child].next_sibling = elem;
+          else
+            p.first_child = elem;
+          p.last_child = elem;
+        }
+        if (tag_end < size and buffer[tag_end - 1] == '/')
+          m_close_order.push_back(elem);
+        else
+          open.push_back(elem);
+        pos = tag_end;
+      } else {
+        if (next == '/' and not open.empty()) {
+          m_close_order.push_back(open.back());
+          open.pop_back();
+        }
+        pos = std::min(buffer.find('>', pos), size);
+      }
+    }
+  }
+
+  std::string_view buffer() const { return m_buffer; }
+
+  /** @brief Number of closed elements. */
+  std::size_t size() const { return m_close_order.size(); }
+
+  /** @brief The @p ind-th closed element, like XML_Doc::operator[]. */
+  LazyElement operator[](std::size_t ind) const {
+    return {this, m_close_order[ind]};
+  }
+
+  /** @brief The last closed element, i.e. the root. */
+  LazyElement back() const { return {this, m_close_order.back()}; }
+
+  /** @brief Number of recorded elements, including unclosed ones. */
+  std::size_t element_count() const { return m_nodes.size(); }
+
+private:
+  friend class LazyElement;
+
+  struct Node {
+    /** Position of the '<' of the start tag. */
+    std::size_t begin;
+    /** Position of the '>' of the start tag. */
+    std::size_t tag_end;
+    std::uint32_t parent;
+    std::uint32_t first_child;
+    std::uint32_t last_child;
+    std::uint32_t next_sibling;
+    std::uint32_t nesting_level;
+  };
+
+  /** @brief Position of the '>' closing the tag, skipping quoted values. */
+  std::size_t find_tag_end(std::size_t pos) const {
+    while ((pos = m_buffer.find_first_of("\">", pos)) !=
+           std::string_view::npos) {
+      if (m_buffer[pos] == '>')
+        return pos;
+      pos = m_buffer.find('"', pos + 1);
+      if (pos == std::string_view::npos)
+        break;
+      ++pos;
+    }
+    return m_buffer.size();
+  }
+
+  /** @brief The start tag of @p node including the '>'. */
+  std::string_view start_tag(Node const &node) const {
+    return m_buffer.substr(node.begin, node.tag_end + 1 - node.begin);
+  }
+
+  std::string_view m_buffer;
+  /** The elements in start tag order. */
+  std::vector<Node> m_nodes;
+  /** Indices of the elements in the order they are closed. */
+  std::vector<std::uint32_t> m_close_order;
+  /** Contents with whitespace inside by element, without it. */
+  mutable std::unordered_map<std::uint32_t, std::string> m_contents;
+  mutable std::mutex m_contents_mutex;
+};
+
+inline LazyElement::Children::iterator &
+LazyElement::Children::iterator::operator++() {
+  m_index = m_doc->m_nodes[m_index].next_sibling;
+  return *this;
+}
+
+inline LazyElement::Children::iterator LazyElement::Children::end() const {
+  return {m_doc, LazyDocument::none};
+}
+
+inline std::string_view LazyElement::name() const {
+  auto const &node = m_doc->m_nodes[m_index];
+  auto const buffer = m_doc->m_buffer;
+  auto end = node.begin + 1;
+  while (end < buffer.size() and detail::is_alpha(buffer[end]))
+    ++end;
+  return buffer.substr(node.begin + 1, end - node.begin - 1);
+}
+
+inline std::size_t LazyElement::nesting_level() const {
+  return m_doc->m_nodes[m_index].nesting_level;
+}
+
+inline bool LazyElement::has_parent() const {
+  return m_doc->m_nodes[m_index].parent != LazyDocument::none;
+}
+
+inline LazyElement LazyElement::parent() const {
+  return {m_doc, m_doc->m_nodes[m_index].parent};
+}
+
+inline LazyElement::Children LazyElement::children() const {
+  return {m_doc, m_doc->m_nodes[m_index].first_child};
+}
+
+inline std::string_view LazyElement::content() const {
+  auto const &node = m_doc->m_nodes[m_index];
+  auto const buffer = m_doc->m_buffer;
+  auto const begin = node.tag_end + 1;
+  if (begin >= buffer.size() or buffer[node.tag_end - 1] == '/' or
+      not detail::is_alnum(buffer[begin]))
+    return {};
+  auto end = std::min(buffer.find('<', begin), buffer.size());
+  while (end > begin and
+         std::isspace(static_cast<unsigned char>(buffer[end - 1])))
+    --end;
+  auto const content = buffer.substr(begin, end - begin);
+  if (not detail::has_space(content))
+    return content;
+  // like the lexers, whitespace inside of the content is skipped
+  std::lock_guard<std::mutex> lock(m_doc->m_contents_mutex);
+  auto const it = m_doc->m_contents.find(m_index);
+  if (it != m_doc->m_contents.end())
+    return it->second;
+  return m_doc->m_contents.emplace(m_index, detail::remove_space(content))
+      .first->second;
+}
+
+inline std::vector<std::pair<std::string_view, std::string_view>>
+LazyElement::attributes() const {
+  std::vector<std::pair<std::string_view, std::string_view>> result;
+  StringLexer lexer(m_doc->start_tag(m_doc->m_nodes[m_index]));
+  while (auto token = lexer.next()) {
+    if (auto const attr =
+            std::get_if<BasicAttribute<std::string_view>>(&*token))
+      result.push_back(attr->key_val);
+  }
+  return result;
+}
+
+inline std::string_view
+LazyElement::get_attribute(std::string_view attr_name) const {
+  StringLexer lexer(m_doc->start_tag(m_doc->m_nodes[m_index]));
+  while (auto token = lexer.next()) {
+    if (auto const attr =
+            std::get_if<BasicAttribute<std::string_view>>(&*token);
+        attr and attr->key_val.first == attr_name)
+      return attr->key_val.second;
+  }
+  return {};
+}
+
+inline void
+LazyElement::get_attributes(std::vector<std::string_view> const &attr_names,
+                            std::vector<std::string_view> &values) const {
+  values.assign(attr_names.size(), {});
+  auto missing = attr_names.size();
+  StringLexer lexer(m_doc->start_tag(m_doc->m_nodes[m_index]));
+  while (missing > 0) {
+    auto const token = lexer.next();
+    if (not token)
+      break;
+    auto const attr = std::get_if<BasicAttribute<std::string_view>>(&*token);
+    if (attr == nullptr)
+      continue;
+    for (std::size_t i = 0; i < attr_names.size(); ++i) {
+      // like get_attribute the first of repeated attributes counts
+      if (values[i].data() == nullptr and
+          attr_names[i] == attr->key_val.first) {
+        values[i] = attr->key_val.second;
+        --missing;
+      }
+    }
+  }
+}
+
+inline LazyElement LazyElement::get_child(std::string_view child_name) const {
+  for (auto const child : children()) {
+    if (child.name() == child_name)
+      return child;
+  }
+  throw std::runtime_error("Child not found");
+}
+
+/**
+ * @brief Filter the elements of a lazy document by their name.
+ *
+ * Only the names of the elements are decoded.
+ *
+ * @param doc The lazy document.
+ * @param filter A compiled filter to match against the element names.
+ * @return The matching elements in the order they are closed.
+ */
+inline std::vector<LazyElement> name_filter(LazyDocument const &doc,
+                                            Filter const &filter) {
+  std::vector<LazyElement> result;
+  for (std::size_t i = 0; i < doc.size(); ++i) {
+    if (auto const elem = doc[i]; filter(elem.name()))
+      result.push_back(elem);
+  }
+  return result;
+}
+
+/**
+ * @brief Filter the elements of a lazy document by an attribute.
+ *
+ * Only the start tags of the elements are decoded.
+ *
+ * @param doc The lazy document.
+ * @param attr The name of the attribute to filter for.
+ * @param filter A compiled filter to match against the attribute values.
+ * @return The matching elements in the order they are closed.
+ */
+inline std::vector<LazyElement> attr_filter(LazyDocument const &doc,
+                                            std::string_view attr,
+                                            Filter const &filter) {
+  std::vector<LazyElement> result;
+  for (std::size_t i = 0; i < doc.size(); ++i) {
+    if (auto const elem = doc[i]; filter(elem.get_attribute(attr)))
+      result.push_back(elem);
+  }
+  return result;
+}
+
+} // namespace XML
+
+#endif
@@ -1,14 +1,28 @@
 #ifndef LEXER_HPP
 #define LEXER_HPP
 
+#include <algorithm>
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
 
+#include "projection.hpp"
+#include "scanner.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+
 /** @file lexer.hpp
  *  @brief This file contains the lexer class and XML token representations.
  */
@@ -18,8 +32,10 @@ namespace XML {
 /**
  * @brief "<" Token
  */
-struct StartTagBegin {
-  std::string name;
+template <class String> struct BasicStartTagBegin {
+  String name;
+  /** Symbol of the name if the lexer interns names. */
+  Symbol symbol = no_symbol;
 };
 
 /**
@@ -35,27 +51,50 @@ struct CloseTag {};
 /**
  * @brief Attribute of a StartTag
  */
-struct Attribute {
-  std::pair<std::string, std::string> key_val;
+template <class String> struct BasicAttribute {
+  std::pair<String, String> key_val;
+  /** Symbol of the key if the lexer interns names. */
+  Symbol key_symbol = no_symbol;
 };
 
 /**
  * @brief The content of an element.
  */
-struct Content {
-  std::string content;
+template <class String> struct BasicContent {
+  String content;
 };
 
 /**
  * @brief "</name>" Token
  */
-struct EndTag {
-  std::string name;
+template <class String> struct BasicEndTag {
+  String name;
+  /** Symbol of the name if the lexer interns names. */
+  Symbol symbol = no_symbol;
 };
 
+/** Type used for all possible tokens with string values of type @p String. */
+template <class String>
+using BasicToken =
+    std::variant<BasicStartTagBegin<String>, StartTagEnd, CloseTag,
+                 BasicAttribute<String>, BasicContent<String>,
+                 BasicEndTag<String>>;
+
+using StartTagBegin = BasicStartTagBegin<std::string>;
+using Attribute = BasicAttribute<std::string>;
+using Content = BasicContent<std::string>;
+using EndTag = BasicEndTag<std::string>;
+
 /** Type used for all possible tokens. */
-using Token = std::variant<StartTagBegin, StartTagEnd, CloseTag, Attribute,
-                           Content, EndTag>;
+using Token = BasicToken<std::string>;
+
+/**
+ * @brief Token type whose strings are views into the lexed buffer.
+ *
+ * Tokens of this type are only valid as long as the buffer they were
+ * created from.
+ */
+using TokenView = BasicToken<std::string_view>;
 
 namespace detail {
 
@@ -81,54 +120,217 @@ std::string extract_string(std::istream &stream) {
  * @brief Extract the next XML content.
  *
  * The non XML element content is read and returned.
- * It is assumed to end at the next tag.
+ * It is assumed to end at the next tag or the end of the stream. Like all
+ * chars read with operator>> its whitespace is skipped.
  *
  * @param[in,out] stream The input stream to read from.
  * @return The XML content as a string.
  */
 std::string extract_content(std::istream &stream) {
-  std::stringstream result;
+  std::string result;
   char c;
-  while (stream.peek() != '<') {
-    stream >> c;
-    result << c;
-  }
-  return result.str();
+  while ((stream >> std::ws).peek() != '<' and stream >> c)
+    result.push_back(c);
+  return result;
+}
+
+/** @brief Whether @p str contains whitespace. */
+inline bool has_space(std::string_view str) {
+  return std::any_of(str.begin(), str.end(), [](char c) {
+    return std::isspace(static_cast<unsigned char>(c));
+  });
 }
 
 /**
- * @brief Extract the next XML attribute.
+ * @brief @p str without its whitespace, i.e. a content as it is read by
+ * the stream Lexer.
+ */
+inline std::string remove_space(std::string_view str) {
+  std::string result;
+  result.reserve(str.size());
+  std::copy_if(str.begin(), str.end(), std::back_inserter(result),
+               [](char c) {
+                 return not std::isspace(static_cast<unsigned char>(c));
+               });
+  return result;
+}
+
+/**
+ * @brief Skip the next XML content.
  *
- * The entire XML attribute is read and returned.
+ * Like extract_content, but the content is not stored.
  *
  * @param[in,out] stream The input stream to read from.
- * @return A pair of identifier and value of the attribute.
  */
-std::pair<std::string, std::string> extract_attribute(std::istream &stream) {
-  // read the identifier
+inline void skip_content(std::istream &stream) {
+  stream.ignore(std::numeric_limits<std::streamsize>::max(), '<');
+  if (not stream.eof())
+    stream.unget();
+}
+
+/**
+ * @brief Extract the identifier of the next XML attribute.
+ *
+ * @param[in,out] stream The input stream to read from, it is left in front
+ * of the value.
+ * @return The identifier of the attribute.
+ */
+inline std::string extract_key(std::istream &stream) {
   std::string key;
   std::getline(stream, key, '=');
-  // read the value of the attribute
+  return key;
+}
+
+/**
+ * @brief Extract the value of an XML attribute following its identifier.
+ *
+ * @param[in,out] stream The input stream to read from.
+ * @return The value of the attribute.
+ */
+inline std::string extract_value(std::istream &stream) {
   std::string value;
   stream.ignore(); // ignore the apostrophe
   std::getline(stream, value, '"');
-  return {key, value};
+  return value;
+}
+
+/**
+ * @brief Skip the value of an XML attribute following its identifier.
+ *
+ * @param[in,out] stream The input stream to read from.
+ */
+inline void skip_value(std::istream &stream) {
+  stream.ignore(); // ignore the apostrophe
+  stream.ignore(std::numeric_limits<std::streamsize>::max(), '"');
+}
+
+/**
+ * @brief Extract the next XML attribute.
+ *
+ * The entire XML attribute is read and returned.
+ *
+ * @param[in,out] stream The input stream to read from.
+ * @return A pair of identifier and value of the attribute.
+ */
+std::pair<std::string, std::string> extract_attribute(std::istream &stream) {
+  auto key = extract_key(stream);
+  return {std::move(key), extract_value(stream)};
+}
+
+/**
+ * @brief Extract the next string from an indexed buffer.
+ *
+ * The string is assumed to end at the next non-alphabetic char.
+ *
+ * @param[in] index The structural index of the buffer to read from.
+ * @param[in,out] pos The read position in the buffer.
+ * @return A view of the extracted string.
+ */
+inline std::string_view extract_string(StructuralIndex &index,
+                                       std::size_t &pos) {
+  auto const begin = pos;
+  pos = index.find(pos, &BlockMasks::non_alpha);
+  return index.buffer().substr(begin, pos - begin);
+}
+
+/**
+ * @brief Extract the next XML content from an indexed buffer.
+ *
+ * The content is assumed to end at the next tag. Trailing whitespace in
+ * front of the next tag is dropped, whitespace inside of the content is
+ * kept since the view cannot skip it, see remove_space.
+ *
+ * @param[in] index The structural index of the buffer to read from.
+ * @param[in,out] pos The read position in the buffer.
+ * @return A view of the XML content.
+ */
+inline std::string_view extract_content(StructuralIndex &index,
+                                        std::size_t &pos) {
+  auto const buffer = index.buffer();
+  auto const begin = pos;
+  pos = index.find(pos, &BlockMasks::lt);
+  auto end = pos;
+  while (end > begin and
+         std::isspace(static_cast<unsigned char>(buffer[end - 1])))
+    --end;
+  return buffer.substr(begin, end - begin);
+}
+
+/**
+ * @brief Extract the next XML attribute from an indexed buffer.
+ *
+ * @param[in] index The structural index of the buffer to read from.
+ * @param[in,out] pos The read position in the buffer.
+ * @return A pair of views of the identifier and value of the attribute.
+ */
+inline std::pair<std::string_view, std::string_view>
+extract_attribute(StructuralIndex &index, std::size_t &pos) {
+  auto const buffer = index.buffer();
+  // read the identifier
+  auto const key_end = index.find(pos, &BlockMasks::eq);
+  auto const key = buffer.substr(pos, key_end - pos);
+  // read the value of the attribute, ignoring the apostrophe
+  auto const value_begin = std::min(key_end + 2, buffer.size());
+  auto const value_end = index.find(value_begin, &BlockMasks::quote);
+  pos = std::min(value_end + 1, buffer.size());
+  return {key, buffer.substr(value_begin, value_end - value_begin)};
 }
 
 } // namespace detail
 
 /**
  * @brief Lexer to generate a list of tokens from the stream of characters.
+ *
+ * If the lexer is given a SymbolTable, the names of the tags and the keys of
+ * the attributes are interned and their symbols are set in the tokens. If
+ * it is given a Projection, only the attributes and contents it keeps are
+ * turned into tokens, the others are skipped without being stored.
  */
 struct Lexer {
+  using string_type = std::string;
+
   std::vector<Token> m_tokens;
   std::istream &m_istream;
+  /** Position the lexer started at, -1 if the stream is not seekable. */
+  std::istream::pos_type m_begin;
+  /** Content token following the last StartTagEnd. */
+  std::optional<Token> m_pending;
+  /** Table the names are interned in, if any. */
+  std::shared_ptr<SymbolTable> m_symbols;
+  /** The attributes and contents to pass on, all if null. */
+  std::shared_ptr<Projection const> m_projection;
+  /** Name of the last start tag, only kept with a projection. */
+  std::string m_tag;
 
   /**
    * @brief The lexer is constructed with a file stream.
    * @param[in] stream The file stream to read from.
+   * @param[in] symbols Table to intern the names in or nullptr.
+   * @param[in] projection The attributes and contents to pass on or nullptr
+   * for all of them.
+   */
+  Lexer(std::istream &stream, std::shared_ptr<SymbolTable> symbols = nullptr,
+        std::shared_ptr<Projection const> projection = nullptr)
+      : m_istream(stream), m_begin(stream.tellg()),
+        m_symbols(std::move(symbols)), m_projection(std::move(projection)) {}
+
+  /**
+   * @brief Read the next token from the input stream.
+   *
+   * The stream is read char by char until the next token is identified.
+   * Only the characters belonging to that token are consumed.
+   *
+   * @return The next token or an empty optional at the end of the stream.
    */
-  Lexer(std::istream &stream) : m_istream(stream) {}
+  std::optional<Token> next() {
+    YAXP_STATS_TIMER(lex);
+    auto token = next_token();
+    if (token)
+      YAXP_STATS_COUNT(tokens, 1);
+    else
+      YAXP_STATS_COUNT(bytes_read, bytes_consumed());
+    return token;
+  }
 
   /**
    * @brief Create a vector of tokens from the input stream.
@@ -140,46 +342,396 @@ struct Lexer {
    * @return A vector of token instances.
    */
   std::vector<Token> tokenize() {
+    while (auto token = next())
+      m_tokens.push_back(std::move(*token));
+    return m_tokens;
+  }
+
+  /** @brief The symbol of @p name or no_symbol without symbol table. */
+  Symbol intern(std::string_view name) {
+    return m_symbols ? m_symbols->intern(name) : no_symbol;
+  }
+
+private:
+  /**
+   * @brief Number of chars read from the stream, 0 if it is not seekable.
+   *
+   * The state of the stream is restored, only its position is queried.
+   */
+  std::uint64_t bytes_consumed() {
+    auto const state = m_istream.rdstate();
+    m_istream.clear();
+    auto const end = m_istream.tellg();
+    m_istream.setstate(state);
+    if (m_begin == std::istream::pos_type(-1) or
+        end == std::istream::pos_type(-1))
+      return 0;
+    return static_cast<std::uint64_t>(end - m_begin);
+  }
+
+  std::optional<Token> next_token() {
+    if (m_pending)
+      return std::exchange(m_pending, std::nullopt);
     char c;
-    while (true) {
-      m_istream >> c;
+    while (m_istream >> c) {
       if (c == '<') {
         if (std::isalpha(m_istream.peek())) {
           // we are reading the name of a StartTagBegin
-          auto const name = detail::extract_string(m_istream);
-          m_tokens.push_back(StartTagBegin{name});
-        } else if (m_istream.peek() == '/') {
+          auto name = detail::extract_string(m_istream);
+          if (m_projection)
+            m_tag = name;
+          auto const symbol = intern(name);
+          return StartTagBegin{std::move(name), symbol};
+        }
+        if (m_istream.peek() == '/') {
           m_istream >> c;
           // we are reading the name of an EndTag
-          auto const name = detail::extract_string(m_istream);
-          m_tokens.push_back(EndTag{name});
+          auto name = detail::extract_string(m_istream);
           m_istream.ignore(); // skip the closing bracket
-          continue;
+          auto const symbol = intern(name);
+          return EndTag{std::move(name), symbol};
         }
       } else if (c == '/') {
         if (m_istream.peek() == '>') {
           m_istream.ignore(); // consume the '>'
-          m_tokens.push_back(CloseTag());
-          continue;
+          return CloseTag();
         }
       } else if (c == '>') {
-        m_tokens.push_back(StartTagEnd());
         if (std::isalnum(m_istream.peek())) {
-          std::string cont = detail::extract_content(m_istream);
-          m_tokens.push_back(Content{cont});
-          continue;
+          if (not m_projection or m_projection->keeps_content(m_tag))
+            m_pending = Content{detail::extract_content(m_istream)};
+          else
+            detail::skip_content(m_istream);
         }
+        return StartTagEnd();
       } else if (std::isalpha(c)) {
         m_istream.putback(c);
         // we are reading an Attribute
-        auto const key_val = detail::extract_attribute(m_istream);
-        m_tokens.push_back(Attribute{key_val});
-        continue;
+        auto key = detail::extract_key(m_istream);
+        if (m_projection and not m_projection->keeps_attribute(key)) {
+          detail::skip_value(m_istream);
+          continue;
+        }
+        auto const symbol = intern(key);
+        return Attribute{{std::move(key), detail::extract_value(m_istream)},
+                         symbol};
       }
-      if (m_istream.eof())
-        break;
     }
-    return m_tokens;
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief Lexer working on a contiguous buffer, e.g. a memory mapped file.
+ *
+ * The produced tokens do not own their strings, names, attribute values and
+ * contents are views into the buffer. The buffer has to outlive the tokens.
+ * Like the Lexer the whitespace inside of contents is skipped, the rare
+ * contents containing some are copied without it into the lexer, which then
+ * has to outlive their tokens as well. Instead of looking at every char the
+ * lexer jumps between the structural chars found by a vectorized
+ * StructuralIndex. Symbols and projections are handled like by the Lexer.
+ */
+struct StringLexer {
+  using string_type = std::string_view;
+
+  std::string_view m_buffer;
+  StructuralIndex m_index;
+  std::size_t m_pos = 0;
+  /** Content token following the last StartTagEnd. */
+  std::optional<TokenView> m_pending;
+  /** Table the names are interned in, if any. */
+  std::shared_ptr<SymbolTable> m_symbols;
+  /** The attributes and contents to pass on, all if null. */
+  std::shared_ptr<Projection const> m_projection;
+  /** Name of the last start tag. */
+  std::string_view m_tag;
+  /** Contents with whitespace inside, without it. */
+  std::deque<std::string> m_contents;
+
+  /**
+   * @brief The lexer is constructed with the buffer to tokenize.
+   * @param[in] buffer The characters to read from.
+   * @param[in] symbols Table to intern the names in or nullptr.
+   * @param[in] projection The attributes and contents to pass on or nullptr
+   * for all of them.
+   */
+  StringLexer(std::string_view buffer,
+              std::shared_ptr<SymbolTable> symbols = nullptr,
+              std::shared_ptr<Projection const> projection = nullptr)
+      : m_buffer(buffer), m_index(buffer), m_symbols(std::move(symbols)),
+        m_projection(std::move(projection)) {}
+
+  /**
+   * @brief Read the next token from the buffer.
+   *
+   * Recognizes the same tokens as Lexer::next.
+   *
+   * @return The next token or an empty optional at the end of the buffer.
+   */
+  std::optional<TokenView> next() {
+    YAXP_STATS_TIMER(lex);
+    auto token = next_token();
+    if (token)
+      YAXP_STATS_COUNT(tokens, 1);
+    else if (m_pos >= m_buffer.size())
+      YAXP_STATS_COUNT(bytes_read, m_buffer.size());
+    return token;
+  }
+
+  /**
+   * @brief Create a vector of tokens from the buffer.
+   *
+   * @return A vector of token instances viewing into the buffer.
+   */
+  std::vector<TokenView> tokenize() {
+    std::vector<TokenView> tokens;
+    while (auto token = next())
+      tokens.push_back(*token);
+    return tokens;
+  }
+
+  /** @brief The symbol of @p name or no_symbol without symbol table. */
+  Symbol intern(std::string_view name) {
+    return m_symbols ? m_symbols->intern(name) : no_symbol;
+  }
+
+private:
+  /** @brief The content @p view without whitespace. */
+  std::string_view content(std::string_view view) {
+    if (not detail::has_space(view))
+      return view;
+    return m_contents.emplace_back(detail::remove_space(view));
+  }
+
+  std::optional<TokenView> next_token() {
+    if (m_pending)
+      return std::exchange(m_pending, std::nullopt);
+    auto const size = m_buffer.size();
+    while ((m_pos = m_index.find(m_pos, &BlockMasks::token)) < size) {
+      auto const c = m_buffer[m_pos++];
+      auto const peek = m_pos < size ? m_buffer[m_pos] : '\0';
+      if (c == '<') {
+        if (detail::is_alpha(peek)) {
+          // we are reading the name of a StartTagBegin
+          auto const name = detail::extract_string(m_index, m_pos);
+          m_tag = name;
+          return BasicStartTagBegin<std::string_view>{name, intern(name)};
+        }
+        if (peek == '/') {
+          ++m_pos;
+          // we are reading the name of an EndTag
+          auto const name = detail::extract_string(m_index, m_pos);
+          ++m_pos; // skip the closing bracket
+          return BasicEndTag<std::string_view>{name, intern(name)};
+        }
+      } else if (c == '/') {
+        if (peek == '>') {
+          ++m_pos; // consume the '>'
+          return CloseTag();
+        }
+      } else if (c == '>') {
+        if (detail::is_alnum(peek)) {
+          if (not m_projection or m_projection->keeps_content(m_tag))
+            m_pending = BasicContent<std::string_view>{
+                content(detail::extract_content(m_index, m_pos))};
+          else
+            m_pos = m_index.find(m_pos, &BlockMasks::lt);
+        }
+        return StartTagEnd();
+      } else {
+        --m_pos;
+        // we are reading an Attribute
+        auto const key_val = detail::extract_attribute(m_index, m_pos);
+        if (m_projection and not m_projection->keeps_attribute(key_val.first))
+          continue;
+        return BasicAttribute<std::string_view>{key_val, intern(key_val.first)};
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief Lexer that is pushed the input in chunks, e.g. read from a pipe.
+ *
+ * The chunks can be of any size, a token may be split across them. Tokens
+ * are emitted as soon as they are complete, a partial token at the end of
+ * the received input is kept until the next chunk arrives. Only the input
+ * of the partial token is buffered. Recognizes the same tokens as the
+ * Lexer, symbols and projections are handled like by the Lexer.
+ */
+struct PushLexer {
+  using string_type = std::string;
+
+  /** Received input that has not been consumed. */
+  std::string m_buffer;
+  std::size_t m_pos = 0;
+  /** Whether all input has been received. */
+  bool m_finished = false;
+  /** Content token following the last StartTagEnd. */
+  std::optional<Token> m_pending;
+  /** Table the names are interned in, if any. */
+  std::shared_ptr<SymbolTable> m_symbols;
+  /** The attributes and contents to pass on, all if null. */
+  std::shared_ptr<Projection const> m_projection;
+  /** Name of the last start tag, only kept with a projection. */
+  std::string m_tag;
+
+  /**
+   * @brief The lexer is constructed without input, it is passed to feed.
+   * @param[in] symbols Table to intern the names in or nullptr.
+   * @param[in] projection The attributes and contents to pass on or nullptr
+   * for all of them.
+   */
+  explicit PushLexer(std::shared_ptr<SymbolTable> symbols = nullptr,
+                     std::shared_ptr<Projection const> projection = nullptr)
+      : m_symbols(std::move(symbols)), m_projection(std::move(projection)) {}
+
+  /**
+   * @brief Append the next chunk of the input.
+   *
+   * @throws std::runtime_error If finish was called before.
+   */
+  void feed(std::string_view chunk) {
+    if (m_finished)
+      throw std::runtime_error("Input after the end of the input");
+    YAXP_STATS_COUNT(bytes_read, chunk.size());
+    // drop the consumed input, only the partial token is kept
+    m_buffer.erase(0, m_pos);
+    m_pos = 0;
+    m_buffer.append(chunk);
+  }
+
+  /** @brief Mark the end of the input, a partial token is completed. */
+  void finish() { m_finished = true; }
+
+  /**
+   * @brief Read the next complete token from the received input.
+   *
+   * @return The next token or an empty optional if more input is needed.
+   * After finish an empty optional marks the end of the input.
+   */
+  std::optional<Token> next() {
+    YAXP_STATS_TIMER(lex);
+    auto token = next_token();
+    if (token)
+      YAXP_STATS_COUNT(tokens, 1);
+    return token;
+  }
+
+  /**
+   * @brief Create a vector of the complete tokens of the received input.
+   *
+   * @return A vector of token instances.
+   */
+  std::vector<Token> tokenize() {
+    std::vector<Token> tokens;
+    while (auto token = next())
+      tokens.push_back(std::move(*token));
+    return tokens;
+  }
+
+  /** @brief The symbol of @p name or no_symbol without symbol table. */
+  Symbol intern(std::string_view name) {
+    return m_symbols ? m_symbols->intern(name) : no_symbol;
+  }
+
+private:
+  /**
+   * @brief Position of the first char from @p pos on that satisfies
+   * @p pred, the end of the buffer if there is none.
+   */
+  template <class Pred> std::size_t find(std::size_t pos, Pred pred) const {
+    auto const it = std::find_if(
+        m_buffer.begin() + static_cast<std::ptrdiff_t>(pos), m_buffer.end(),
+        pred);
+    return static_cast<std::size_t>(it - m_buffer.begin());
+  }
+
+  /** @brief Whether the token ending at @p end still needs input. */
+  bool incomplete(std::size_t end) const {
+    return end >= m_buffer.size() and not m_finished;
+  }
+
+  std::optional<Token> next_token() {
+    if (m_pending)
+      return std::exchange(m_pending, std::nullopt);
+    auto const size = m_buffer.size();
+    auto const not_alpha = [](char c) { return not detail::is_alpha(c); };
+    // m_pos is only moved behind complete tokens
+    while ((m_pos = find(m_pos, [](char c) {
+              return not std::isspace(static_cast<unsigned char>(c));
+            })) < size) {
+      auto const c = m_buffer[m_pos];
+      auto pos = m_pos + 1;
+      if (incomplete(pos))
+        return std::nullopt;
+      auto const peek = pos < size ? m_buffer[pos] : '\0';
+      if (c == '<') {
+        if (detail::is_alpha(peek)) {
+          // we are reading the name of a StartTagBegin
+          auto const end = find(pos, not_alpha);
+          if (incomplete(end))
+            return std::nullopt;
+          auto name = m_buffer.substr(pos, end - pos);
+          m_pos = end;
+          if (m_projection)
+            m_tag = name;
+          auto const symbol = intern(name);
+          return StartTagBegin{std::move(name), symbol};
+        }
+        if (peek == '/') {
+          // we are reading the name of an EndTag
+          auto const end = find(pos + 1, not_alpha);
+          if (incomplete(end))
+            return std::nullopt;
+          auto name = m_buffer.substr(pos + 1, end - pos - 1);
+          m_pos = std::min(end + 1, size); // skip the closing bracket
+          auto const symbol = intern(name);
+          return EndTag{std::move(name), symbol};
+        }
+      } else if (c == '/') {
+        if (peek == '>') {
+          m_pos = pos + 1; // consume the '>'
+          return CloseTag();
+        }
+      } else if (c == '>') {
+        if (detail::is_alnum(peek)) {
+          auto const end = m_buffer.find('<', pos);
+          if (incomplete(end))
+            return std::nullopt;
+          m_pos = std::min(end, size);
+          if (not m_projection or m_projection->keeps_content(m_tag)) {
+            // like the Lexer, whitespace inside of the content is skipped
+            m_pending = Content{detail::remove_space(
+                std::string_view(m_buffer).substr(pos, m_pos - pos))};
+          }
+        } else {
+          m_pos = pos;
+        }
+        return StartTagEnd();
+      } else if (detail::is_alpha(c)) {
+        // we are reading an Attribute
+        auto const key_end = std::min(m_buffer.find('=', m_pos), size);
+        // the value follows the apostrophe
+        auto const value_begin = std::min(key_end + 2, size);
+        auto const value_end = std::min(m_buffer.find('"', value_begin), size);
+        if (incomplete(value_end))
+          return std::nullopt;
+        auto key = m_buffer.substr(m_pos, key_end - m_pos);
+        m_pos = std::min(value_end + 1, size);
+        if (m_projection and not m_projection->keeps_attribute(key))
+          continue;
+        auto const symbol = intern(key);
+        return Attribute{
+            {std::move(key),
+             m_buffer.substr(value_begin, value_end - value_begin)},
+            symbol};
+      }
+      m_pos = pos;
+    }
+    return std::nullopt;
   }
 };
 
@@ -0,0 +1,78 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @file mapped_file.hpp
+ *  @brief This file contains a read-only memory mapping of a file.
+ */
+
+namespace XML {
+
+/**
+ * @brief Read-only memory mapping of a regular file.
+ *
+ * The mapped characters are accessible as a string view for the lifetime of
+ * the instance, which makes it a suitable buffer for the StringLexer.
+ */
+class MappedFile {
+public:
+  /**
+   * @brief Map the file at @p path into memory.
+   *
+   * @param path Path to a regular file.
+   * @throws std::runtime_error If the file cannot be opened or mapped.
+   */
+  explicit MappedFile(std::string const &path) {
+    auto const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Could not open file: " + path);
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 or not S_ISREG(info.st_mode)) {
+      ::close(fd);
+      throw std::runtime_error("Not a regular file: " + path);
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    if (m_size != 0) {
+      m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (m_data == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Could not map file: " + path);
+      }
+      // the lexer reads the mapping front to back
+      ::madvise(m_data, m_size, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+  }
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+  ~MappedFile() {
+    if (m_data != nullptr)
+      ::munmap(m_data, m_size);
+  }
+
+  /** @brief The mapped characters. */
+  std::string_view view() const {
+    return {static_cast<char const *>(m_data), m_size};
+  }
+
+  std::size_t size() const { return m_size; }
+
+private:
+  void *m_data = nullptr;
+  std::size_t m_size = 0;
+};
+
+} // namespace XML
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef PARALLEL_PARSER_HPP
+#define PARALLEL_PARSER_HPP
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "thread_pool.hpp"
+
+/** @file parallel_parser.hpp
+ *  @brief This file contains the multithreaded parser for large documents.
+ */
+
+namespace XML {
+
+namespace detail {
+
+/**
+ * @brief The elements built from one chunk of a document.
+ */
+struct Chunk {
+  XML_Doc doc;
+  /** The elements of the chunk that are children of the root. */
+  std::vector<XML_Element *> top_level;
+  /** Number of elements that are still open at the end of the chunk. */
+  std::size_t open = 0;
+  /** Number of end tags closing elements outside of the chunk. */
+  std::size_t unmatched_ends = 0;
+};
+
+/**
+ * @brief Build the elements in @p chunk as children of @p root.
+ */
+inline Chunk parse_chunk(std::string_view chunk, XML_Element *root,
+                         std::shared_ptr<Projection const> projection) {
+  Chunk result;
+  auto const &symbols = result.doc.m_symbols;
+  DocumentBuilder<std::string_view> builder(result.doc, root, symbols.get());
+  StringLexer lexer(chunk, symbols, std::move(projection));
+  while (auto token = lexer.next())
+    builder.add(*token);
+  result.top_level = builder.top_level();
+  result.open = builder.open_elements().size();
+  result.unmatched_ends = builder.unmatched_ends();
+  return result;
+}
+
+/**
+ * @brief Find the next start tag with name @p name at or after @p pos.
+ *
+ * @return Position of the '<' or std::string_view::npos.
+ */
+inline std::size_t find_start_tag(std::string_view buffer,
+                                  std::string_view name, std::size_t pos) {
+  auto const tag = "<" + std::string(name);
+  while ((pos = buffer.find(tag, pos)) != std::string_view::npos) {
+    auto const end = pos + tag.size();
+    if (end == buffer.size() or not is_alpha(buffer[end]))
+      return pos;
+    pos = end;
+  }
+  return pos;
+}
+
+/**
+ * @brief Move the names of the elements of @p chunk to another symbol table.
+ *
+ * @param chunk The chunk, its elements use the symbols of its own table.
+ * @param symbols The symbol in @p table of each symbol of the chunk.
+ * @param table The symbol table the names are moved to.
+ */
+inline void remap_symbols(Chunk &chunk, std::vector<Symbol> const &symbols,
+                          SymbolTable const &table) {
+  for (auto const elem : chunk.doc) {
+    elem->symbol = symbols[elem->symbol];
+    elem->name = table.name(elem->symbol);
+    for (auto &attr : elem->attributes) {
+      attr.key_symbol = symbols[attr.key_symbol];
+      attr.key_val.first = table.name(attr.key_symbol);
+    }
+  }
+}
+
+/** @brief Parse @p buffer on the calling thread. */
+inline XML_Doc
+parse_sequential(std::string_view buffer,
+                 std::shared_ptr<Projection const> projection) {
+  XML_Doc doc;
+  DocumentBuilder<std::string_view> builder(doc, nullptr, doc.m_symbols.get());
+  StringLexer lexer(buffer, doc.m_symbols, std::move(projection));
+  while (auto token = lexer.next())
+    builder.add(*token);
+  return doc;
+}
+
+} // namespace detail
+
+/**
+ * @brief Parse a document using all threads of @p pool.
+ *
+ * The buffer is split in front of start tags that have the name of the first
+ * child of the root, e.g. between the <city> elements of <data>. The chunks
+ * are lexed and parsed concurrently and their elements are stitched together
+ * in document order below the root. The result is the same document the
+ * StringParser produces. If a split turns out not to be between children of
+ * the root, e.g. because elements with that name are nested, the document is
+ * parsed sequentially.
+ *
+ * @param buffer The document.
+ * @param pool The threads to parse on.
+ * @param min_chunk_size Lower bound of the size of a chunk in bytes.
+ * @param projection The attributes and contents to parse or nullptr for all
+ * of them.
+ * @return The parsed document.
+ */
+inline XML_Doc
+parse_parallel(std::string_view buffer, ThreadPool &pool,
+               std::size_t min_chunk_size = 1 << 20,
+               std::shared_ptr<Projection const> projection = nullptr) {
+  // parse the start tag of the root up to its first child
+  XML_Doc doc;
+  DocumentBuilder<std::string_view> builder(doc);
+  StringLexer lexer(buffer, nullptr, projection);
+  std::string_view child_name;
+  while (auto token = lexer.next()) {
+    if (auto const start =
+            std::get_if<BasicStartTagBegin<std::string_view>>(&*token);
+        start and builder.open_elements().size() == 1) {
+      child_name = start->name;
+      break;
+    }
+    builder.add(*token);
+  }
+  if (child_name.empty() or builder.open_elements().size() != 1)
+    return detail::parse_sequential(buffer, projection);
+  auto const root = builder.open_elements().front();
+
+  // split the children of the root into chunks
+  auto const first_child =
+      static_cast<std::size_t>(child_name.data() - buffer.data()) - 1;
+  // the chunk lexers count their own bytes, the prefix is only lexed here
+  YAXP_STATS_COUNT(bytes_read, first_child);
+  auto const chunk_size = std::max(
+      min_chunk_size, (buffer.size() - first_child) / (4 * pool.size()) + 1);
+  std::vector<std::size_t> bounds = {first_child};
+  for (auto pos = first_child + chunk_size; pos < buffer.size();
+       pos = bounds.back() + chunk_size) {
+    pos = detail::find_start_tag(buffer, child_name, pos);
+    if (pos == std::string_view::npos)
+      break;
+    bounds.push_back(pos);
+  }
+  bounds.push_back(buffer.size());
+
+  std::vector<std::future<detail::Chunk>> futures;
+  for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+    auto const chunk = buffer.substr(bounds[i], bounds[i + 1] - bounds[i]);
+    futures.push_back(pool.submit([chunk, root, &projection]() {
+      return detail::parse_chunk(chunk, root, projection);
+    }));
+  }
+  // all tasks refer to buffer and projection, wait for them before any
+  // error is rethrown
+  for (auto &future : futures)
+    future.wait();
+  std::vector<detail::Chunk> chunks;
+  for (auto &future : futures)
+    chunks.push_back(future.get());
+
+  // all but the last chunk are balanced, the last one closes the root
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    auto const closes_root = i + 1 == chunks.size() ? 1u : 0u;
+    if (chunks[i].open != 0 or chunks[i].unmatched_ends != closes_root)
+      return detail::parse_sequential(buffer, projection);
+  }
+
+  // every chunk has its own symbol table, move all names to the one of doc
+  std::vector<std::vector<Symbol>> symbols(chunks.size());
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    auto const &chunk_symbols = *chunks[i].doc.m_symbols;
+    for (Symbol s = 0; s < chunk_symbols.size(); ++s)
+      symbols[i].push_back(doc.m_symbols->intern(chunk_symbols.name(s)));
+  }
+  std::vector<std::future<void>> remapped;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    remapped.push_back(pool.submit([&chunks, &symbols, &doc, i]() {
+      detail::remap_symbols(chunks[i], symbols[i], *doc.m_symbols);
+    }));
+  }
+  for (auto &future : remapped)
+    future.wait();
+  for (auto &future : remapped)
+    future.get();
+
+  // stitch the chunks together in document order
+  for (auto &chunk : chunks) {
+    doc.m_arena->adopt(std::move(*chunk.doc.m_arena));
+    doc.m_data.insert(doc.m_data.end(), chunk.doc.begin(), chunk.doc.end());
+    for (auto const elem : chunk.top_level) {
+      if (root->last_child)
+        root->last_child->next_sibling = elem;
+      else
+        root->first_child = elem;
+      root->last_child = elem;
+    }
+  }
+  doc.add_element(root);
+  return doc;
+}
+
+/**
+ * @brief Parse a document using @p threads threads.
+ *
+ * @see parse_parallel(std::string_view, ThreadPool &, std::size_t,
+ * std::shared_ptr<Projection const>)
+ */
+inline XML_Doc parse_parallel(std::string_view buffer, std::size_t threads) {
+  ThreadPool pool(threads);
+  return parse_parallel(buffer, pool);
+}
+
+} // namespace XML
+
+#endif
@@ -1,14 +1,20 @@
 #ifndef PARSER_HPP
 #define PARSER_HPP
 
+#include <algorithm>
 #include <cassert>
+#include <iterator>
 #include <memory>
-#include <regex>
-#include <stack>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "arena.hpp"
+#include "filter.hpp"
 #include "lexer.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
 
 /** @file parser.hpp
  *  @brief This file contains the parser class and XML representations.
@@ -20,26 +26,75 @@ namespace XML {
  * @brief Representation of a XML attribute.
  */
 struct XML_Attribute {
-  std::pair<std::string, std::string> key_val;
+  std::pair<std::string_view, std::string_view> key_val;
+  /** Symbol of the key in the symbol table of the document. */
+  Symbol key_symbol = no_symbol;
 };
 
 /**
  * @brief Representation of a XML element.
  *
  * The data members contain all information that is needed to represent
- * a node in the hierarchical structure of a XML document.
+ * a node in the hierarchical structure of a XML document. Elements, their
+ * attributes and strings live in the Arena of their XML_Doc and are linked
+ * by raw pointers, they are only valid as long as the document. Names and
+ * attribute keys are views of the SymbolTable of the document, looking them
+ * up by Symbol compares integers.
  */
 struct XML_Element {
-  std::string name;
-  std::shared_ptr<XML_Element> parent;
-  std::size_t nesting_level;
-  std::vector<std::shared_ptr<XML_Element>> children;
-  std::vector<XML_Attribute> attributes;
-  std::string content;
-  XML_Element(std::string n, std::shared_ptr<XML_Element> p, std::size_t l)
-      : name(std::move(n)), parent(std::move(p)), nesting_level(l) {}
-
-  std::string get_attribute(std::string attr_name) const {
+  /**
+   * @brief Forward range over the children of an element.
+   */
+  struct Children {
+    struct iterator {
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = XML_Element *;
+      using difference_type = std::ptrdiff_t;
+      using pointer = XML_Element *const *;
+      using reference = XML_Element *const &;
+
+      XML_Element *m_elem;
+
+      reference operator*() const { return m_elem; }
+      iterator &operator++() {
+        m_elem = m_elem->next_sibling;
+        return *this;
+      }
+      iterator operator++(int) {
+        auto const old = *this;
+        ++*this;
+        return old;
+      }
+      bool operator==(iterator const &other) const {
+        return m_elem == other.m_elem;
+      }
+      bool operator!=(iterator const &other) const {
+        return m_elem != other.m_elem;
+      }
+    };
+
+    XML_Element *m_first;
+
+    iterator begin() const { return {m_first}; }
+    iterator end() const { return {nullptr}; }
+    bool empty() const { return m_first == nullptr; }
+  };
+
+  std::string_view name;
+  /** Symbol of the name in the symbol table of the document. */
+  Symbol symbol = no_symbol;
+  XML_Element *parent = nullptr;
+  std::size_t nesting_level = 0;
+  XML_Element *first_child = nullptr;
+  XML_Element *last_child = nullptr;
+  XML_Element *next_sibling = nullptr;
+  Span<XML_Attribute> attributes;
+  std::string_view content;
+
+  /** @brief The children of the element in document order. */
+  Children children() const { return {first_child}; }
+
+  std::string_view get_attribute(std::string_view attr_name) const {
     auto const res = std::find_if(attributes.begin(), attributes.end(),
                                   [attr_name](auto const &attr) {
                                     return attr.key_val.first == attr_name;
@@ -49,28 +104,57 @@ struct XML_Element {
     return {};
   }
 
-  XML_Element get_child(std::string child_name) {
-    auto const res = std::find_if(
-        children.begin(), children.end(),
-        [child_name](auto child) { return (*child).name == child_name; });
-    if (res != children.end())
-      return **res;
+  /** @brief The value of the attribute with key @p key or an empty view. */
+  std::string_view get_attribute(Symbol key) const {
+    for (auto const &attr : attributes) {
+      if (attr.key_symbol == key)
+        return attr.key_val.second;
+    }
+    return {};
+  }
+
+  XML_Element const &get_child(std::string_view child_name) const {
+    for (auto child = first_child; child; child = child->next_sibling) {
+      if (child->name == child_name)
+        return *child;
+    }
     throw std::runtime_error("Child not found");
   }
+
+  /**
+   * @brief The first child named @p child_name.
+   *
+   * @return The child or nullptr if there is none.
+   */
+  XML_Element const *find_child(Symbol child_name) const {
+    for (auto child = first_child; child; child = child->next_sibling) {
+      if (child->symbol == child_name)
+        return child;
+    }
+    return nullptr;
+  }
 };
 
+/**
+ * @brief A XML document, i.e. its elements in the order they are closed.
+ *
+ * The document owns an Arena holding the elements and the SymbolTable of
+ * their names. Copies of a document, e.g. the results of the filters, share
+ * the arena and the symbol table of the original.
+ */
 struct XML_Doc {
-  using value_type = std::shared_ptr<XML_Element>;
+  using value_type = XML_Element *;
   using container_type = std::vector<value_type>;
   using iterator = container_type::iterator;
   using const_iterator = container_type::const_iterator;
   using size_type = container_type::size_type;
 
   container_type m_data;
+  std::shared_ptr<Arena> m_arena = std::make_shared<Arena>();
+  /** Table of the names of the elements and the keys of the attributes. */
+  std::shared_ptr<SymbolTable> m_symbols = std::make_shared<SymbolTable>();
 
-  value_type back() { return m_data.back(); }
-
-  const value_type back() const { return m_data.back(); }
+  value_type back() const { return m_data.back(); }
 
   iterator begin() { return m_data.begin(); }
 
@@ -82,32 +166,140 @@ struct XML_Doc {
 
   size_type size() const { return m_data.size(); }
 
-  std::shared_ptr<XML_Element> operator[](std::size_t ind) const {
+  XML_Element *operator[](std::size_t ind) const {
     assert(ind < m_data.size());
     return m_data[ind];
   }
 
-  void push_back(std::shared_ptr<XML_Element> element) {
-    m_data.push_back(element);
+  void push_back(XML_Element *element) { m_data.push_back(element); }
+
+  void add_element(XML_Element *element) { push_back(element); }
+
+  /**
+   * @brief Create a new element in the arena of the document.
+   *
+   * The element is appended to the children of @p parent, it is not added
+   * to the document, see add_element.
+   *
+   * @param name Symbol of the name of the element in m_symbols.
+   * @param parent The parent element or nullptr for the root.
+   * @param nesting_level The nesting level of the element.
+   * @return The new element.
+   */
+  XML_Element *create_element(Symbol name, XML_Element *parent,
+                              std::size_t nesting_level) {
+    YAXP_STATS_COUNT(elements, 1);
+    auto const elem = m_arena->create<XML_Element>();
+    elem->name = m_symbols->name(name);
+    elem->symbol = name;
+    elem->parent = parent;
+    elem->nesting_level = nesting_level;
+    if (parent) {
+      if (parent->last_child)
+        parent->last_child->next_sibling = elem;
+      else
+        parent->first_child = elem;
+      parent->last_child = elem;
+    }
+    return elem;
+  }
+
+  /**
+   * @brief Create a new element in the arena of the document.
+   *
+   * @param name Name of the element, it is interned.
+   * @see create_element(Symbol, XML_Element *, std::size_t)
+   */
+  XML_Element *create_element(std::string_view name, XML_Element *parent,
+                              std::size_t nesting_level) {
+    return create_element(m_symbols->intern(name), parent, nesting_level);
+  }
+
+  /**
+   * @brief Copy the attributes in [first, last) to @p elem.
+   *
+   * @param elem Element of this document.
+   * @param first, last Range of key-value pairs convertible to string views.
+   * @param keys Symbols of the keys in m_symbols, one per attribute.
+   */
+  template <class ForwardIt, class SymbolIt>
+  void set_attributes(XML_Element &elem, ForwardIt first, ForwardIt last,
+                      SymbolIt keys) {
+    auto const size = static_cast<std::size_t>(std::distance(first, last));
+    auto const attributes = m_arena->allocate_array<XML_Attribute>(size);
+    for (std::size_t i = 0; i < size; ++i, ++first, ++keys) {
+      new (attributes + i) XML_Attribute{
+          {m_symbols->name(*keys), m_arena->copy(first->second)}, *keys};
+    }
+    elem.attributes = {attributes, size};
+  }
+
+  /**
+   * @brief Copy the attributes in [first, last) to @p elem.
+   *
+   * @param elem Element of this document.
+   * @param first, last Range of key-value pairs convertible to string views,
+   * the keys are interned.
+   */
+  template <class ForwardIt>
+  void set_attributes(XML_Element &elem, ForwardIt first, ForwardIt last) {
+    std::vector<Symbol> keys;
+    for (auto it = first; it != last; ++it)
+      keys.push_back(m_symbols->intern(it->first));
+    set_attributes(elem, first, last, keys.begin());
   }
 
-  void add_element(std::shared_ptr<XML_Element> element) { push_back(element); }
+  /** @brief Copy @p content to @p elem. */
+  void set_content(XML_Element &elem, std::string_view content) {
+    elem.content = m_arena->copy(content);
+  }
 };
 
+/**
+ * @brief Find elements with matching names.
+ *
+ * @param doc The parsed XML document.
+ * @param filter A compiled filter to match against the XML element names in
+ * the given doc.
+ * @return A XML document containing matched elements, it shares the elements
+ * with @p doc.
+ */
+XML_Doc name_filter(XML_Doc const &doc, Filter const &filter) {
+  XML_Doc result{{}, doc.m_arena, doc.m_symbols};
+  std::copy_if(doc.begin(), doc.end(), std::back_inserter(result),
+               [&filter](auto elem) { return filter(elem->name); });
+  return result;
+}
+
 /**
  * @brief Find elements with matching names.
  *
  * @param doc The parsed XML document.
  * @param name_regex A regex string to match against the XML element names in
  * the given doc.
- * @return A XML document containing matched elements.
+ * @return A XML document containing matched elements, it shares the elements
+ * with @p doc.
+ */
+XML_Doc name_filter(XML_Doc const &doc, std::string_view name_regex) {
+  return name_filter(doc, Filter(name_regex));
+}
+
+/**
+ * @brief Find elements with matching attributes names.
+ *
+ * @param doc The parsed XML document.
+ * @param attr The name of the attribute to filter for.
+ * @param filter A compiled filter to match against the attribute values in
+ * the given doc.
+ * @return A XML document containing matched elements, it shares the elements
+ * with @p doc.
  */
-XML_Doc name_filter(XML_Doc const &doc, std::string name_regex) {
-  std::regex regex(name_regex);
-  XML_Doc result;
+XML_Doc attr_filter(XML_Doc const &doc, std::string_view attr,
+                    Filter const &filter) {
+  XML_Doc result{{}, doc.m_arena, doc.m_symbols};
   std::copy_if(
       doc.begin(), doc.end(), std::back_inserter(result),
-      [regex](auto elem) { return std::regex_match(elem->name, regex); });
+      [&filter, attr](auto elem) { return filter(elem->get_attribute(attr)); });
   return result;
 }
 
@@ -118,33 +310,153 @@ XML_Doc name_filter(XML_Doc const &doc, std::string name_regex) {
  * @param attr The name of the attribute to filter for.
  * @param val_regex A regex string to match against the XML element names in
  * the given doc.
- * @return A XML document containing matched elements.
+ * @return A XML document containing matched elements, it shares the elements
+ * with @p doc.
  */
-XML_Doc attr_filter(XML_Doc const &doc, std::string attr,
-                    std::string val_regex) {
-  std::regex regex(val_regex);
-  XML_Doc result;
-  std::copy_if(doc.begin(), doc.end(), std::back_inserter(result),
-               [regex, attr](auto elem) {
-                 return std::regex_match(elem->get_attribute(attr), regex);
-               });
-  return result;
+XML_Doc attr_filter(XML_Doc const &doc, std::string_view attr,
+                    std::string_view val_regex) {
+  return attr_filter(doc, attr, Filter(val_regex));
 }
 
+/**
+ * @brief Builds the elements of a XML document from a sequence of tokens.
+ *
+ * The builder keeps the stack of open elements. It can also be started below
+ * an element that is not part of its document, which is used to build the
+ * subtrees of a document independently, see parse_parallel. The symbols of
+ * the tokens are used if they were interned in the symbol table of the
+ * document, otherwise the names are interned by the builder.
+ *
+ * @tparam String The string type of the tokens.
+ */
+template <class String> class DocumentBuilder {
+public:
+  /**
+   * @brief Constructor of the builder.
+   *
+   * @param doc The document to add the elements to.
+   * @param base Parent of the top-level elements, they are not linked into
+   * its children but collected in top_level(). nullptr for a new root.
+   * @param token_symbols The table the symbols of the tokens belong to.
+   */
+  explicit DocumentBuilder(XML_Doc &doc, XML_Element *base = nullptr,
+                           SymbolTable const *token_symbols = nullptr)
+      : m_doc(doc), m_base(base),
+        m_base_level(base ? base->nesting_level + 1 : 0),
+        m_use_token_symbols(token_symbols != nullptr and
+                            token_symbols == doc.m_symbols.get()) {}
+
+  /** @brief Add the next token. */
+  void add(BasicToken<String> const &token) {
+    YAXP_STATS_TIMER(parse);
+    std::visit(
+        [this](auto const &arg) {
+          using T = std::decay_t<decltype(arg)>;
+          if constexpr (std::is_same_v<T, BasicAttribute<String>>) {
+            m_attributes.push_back(arg.key_val);
+            m_attribute_symbols.push_back(
+                symbol(arg.key_val.first, arg.key_symbol));
+            return;
+          }
+          flush_attributes();
+          if constexpr (std::is_same_v<T, BasicStartTagBegin<String>>) {
+            // update the current parent
+            auto const level = m_base_level + m_parents.size();
+            auto const name = symbol(arg.name, arg.symbol);
+            if (m_parents.empty()) {
+              auto const elem = m_doc.create_element(name, nullptr, level);
+              elem->parent = m_base;
+              if (m_base)
+                m_top_level.push_back(elem);
+              m_parents.push_back(elem);
+            } else {
+              m_parents.push_back(
+                  m_doc.create_element(name, m_parents.back(), level));
+            }
+          } else if constexpr (std::is_same_v<T, BasicContent<String>>) {
+            if (not m_parents.empty())
+              m_doc.set_content(*m_parents.back(), arg.content);
+          } else if constexpr (std::is_same_v<T, XML::CloseTag> or
+                               std::is_same_v<T, BasicEndTag<String>>) {
+            if (m_parents.empty()) {
+              // closing the base or an unbalanced end tag
+              ++m_unmatched_ends;
+              return;
+            }
+            // we are closing the current parent and store it
+            m_doc.add_element(m_parents.back());
+            m_parents.pop_back();
+          }
+        },
+        token);
+  }
+
+  /** @brief The currently open elements, outermost first. */
+  std::vector<XML_Element *> const &open_elements() const {
+    return m_parents;
+  }
+
+  /** @brief The elements added directly below the base. */
+  std::vector<XML_Element *> const &top_level() const { return m_top_level; }
+
+  /** @brief Number of end tags without open element. */
+  std::size_t unmatched_ends() const { return m_unmatched_ends; }
+
+private:
+  Symbol symbol(String const &name, Symbol token_symbol) {
+    if (m_use_token_symbols and token_symbol != no_symbol)
+      return token_symbol;
+    return m_doc.m_symbols->intern(name);
+  }
+
+  void flush_attributes() {
+    if (m_attributes.empty())
+      return;
+    if (not m_parents.empty()) {
+      m_doc.set_attributes(*m_parents.back(), m_attributes.begin(),
+                           m_attributes.end(), m_attribute_symbols.begin());
+    }
+    m_attributes.clear();
+    m_attribute_symbols.clear();
+  }
+
+  XML_Doc &m_doc;
+  XML_Element *m_base;
+  std::size_t m_base_level;
+  std::vector<XML_Element *> m_parents;
+  // the attributes of the top element, copied to the arena in one array
+  std::vector<std::pair<String, String>> m_attributes;
+  std::vector<Symbol> m_attribute_symbols;
+  bool m_use_token_symbols;
+  std::vector<XML_Element *> m_top_level;
+  std::size_t m_unmatched_ends = 0;
+};
+
 /**
  * @brief Class to transform tokens to a XML document representation.
  *
  * The XML document is represented by a vector of XML_Element instances.
+ * The parser accepts owning tokens as well as token views, their strings
+ * are copied into the arena of the document.
+ *
+ * @tparam String The string type of the tokens.
  */
-struct Parser {
-  std::vector<XML::Token> m_tokens;
+template <class String> struct BasicParser {
+  std::vector<BasicToken<String>> m_tokens;
+  /** Table the names of the tokens were interned in, if any. */
+  std::shared_ptr<SymbolTable> m_symbols;
 
   /**
    * @brief Constructor of the parser class.
    *
    * @param tokens A vector of XML tokens.
+   * @param symbols The symbol table of the lexer the tokens come from, it
+   * becomes the symbol table of the document. nullptr if the lexer did not
+   * intern the names.
    */
-  Parser(std::vector<XML::Token> tokens) : m_tokens(std::move(tokens)) {}
+  BasicParser(std::vector<BasicToken<String>> tokens,
+              std::shared_ptr<SymbolTable> symbols = nullptr)
+      : m_tokens(std::move(tokens)), m_symbols(std::move(symbols)) {}
 
   /**
    * @brief Map the vector of XML tokens to a vector of XML elements.
@@ -152,40 +464,22 @@ struct Parser {
    * @return The vector of XML elements.
    */
   XML_Doc parse() {
-    std::stack<std::shared_ptr<XML_Element>> parents;
     XML_Doc doc;
-    for (auto &t : m_tokens) {
-      std::visit(
-          [&parents, &doc](auto &&arg) {
-            using T = std::decay_t<decltype(arg)>;
-            if constexpr (std::is_same_v<T, XML::StartTagBegin>) {
-              // update the current parent
-              if (parents.empty()) {
-                parents.push(
-                    std::make_shared<XML_Element>(arg.name, nullptr, 0));
-              } else {
-                auto new_elem = std::make_shared<XML_Element>(
-                    arg.name, parents.top(), parents.size());
-                parents.top()->children.push_back(new_elem);
-                parents.push(new_elem);
-              }
-            } else if constexpr (std::is_same_v<T, XML::Attribute>) {
-              parents.top()->attributes.push_back(XML_Attribute{arg.key_val});
-            } else if constexpr (std::is_same_v<T, XML::Content>) {
-              parents.top()->content = arg.content;
-            } else if constexpr (std::is_same_v<T, XML::CloseTag> or
-                                 std::is_same_v<T, XML::EndTag>) {
-              // we are closing the current parent and store it
-              doc.add_element(parents.top());
-              parents.pop();
-            }
-          },
-          t);
-    }
+    if (m_symbols)
+      doc.m_symbols = m_symbols;
+    DocumentBuilder<String> builder(doc, nullptr, m_symbols.get());
+    for (auto const &t : m_tokens)
+      builder.add(t);
     return doc;
   }
 };
 
+/** Parser for owning tokens as produced by the Lexer. */
+using Parser = BasicParser<std::string>;
+
+/** Parser for token views as produced by the StringLexer. */
+using StringParser = BasicParser<std::string_view>;
+
 } // namespace XML
 
 #endif
@@ -0,0 +1,59 @@
+#ifndef PROJECTION_HPP
+#define PROJECTION_HPP
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/** @file projection.hpp
+ *  @brief This file contains the set of fields a lexer passes on.
+ */
+
+namespace XML {
+
+/**
+ * @brief The attributes and contents a consumer of the tokens reads.
+ *
+ * A lexer given a projection skips all other attributes and the contents of
+ * all other elements without creating tokens for them. The names are
+ * compared linearly, which is faster than hashing for the few fields a
+ * query references.
+ */
+class Projection {
+public:
+  /** @brief Keep the attributes with the key @p key. */
+  void add_attribute(std::string_view key) { add(m_attributes, key); }
+
+  /** @brief Keep the contents of the elements named @p name. */
+  void add_content(std::string_view name) { add(m_contents, name); }
+
+  bool keeps_attribute(std::string_view key) const {
+    return contains(m_attributes, key);
+  }
+
+  bool keeps_content(std::string_view name) const {
+    return contains(m_contents, name);
+  }
+
+  std::vector<std::string> const &attributes() const { return m_attributes; }
+  std::vector<std::string> const &contents() const { return m_contents; }
+
+private:
+  static bool contains(std::vector<std::string> const &names,
+                       std::string_view name) {
+    return std::find(names.begin(), names.end(), name) != names.end();
+  }
+
+  static void add(std::vector<std::string> &names, std::string_view name) {
+    if (not contains(names, name))
+      names.emplace_back(name);
+  }
+
+  std::vector<std::string> m_attributes;
+  std::vector<std::string> m_contents;
+};
+
+} // namespace XML
+
+#endif
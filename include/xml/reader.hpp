@@ -0,0 +1,147 @@
+#ifndef READER_HPP
+#define READER_HPP
+
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "lexer.hpp"
+
+/** @file reader.hpp
+ *  @brief This file contains a streaming pull parser for XML documents.
+ */
+
+namespace XML {
+
+/**
+ * @brief Event emitted by the Reader.
+ *
+ * Start tags are reported with their name followed by their attributes and
+ * content. Every element is closed by exactly one EndTag event, also
+ * elements that are closed by "/>".
+ */
+template <class String>
+using BasicEvent =
+    std::variant<BasicStartTagBegin<String>, BasicAttribute<String>,
+                 BasicContent<String>, BasicEndTag<String>>;
+
+using Event = BasicEvent<std::string>;
+using EventView = BasicEvent<std::string_view>;
+
+/**
+ * @brief Streaming pull parser.
+ *
+ * Pulls the tokens from the lexer one at a time and turns them into events.
+ * In contrast to the Parser no token vector or document is materialized,
+ * the only state that is kept are the names of the currently open elements.
+ *
+ * With a PushLexer next returns an empty optional whenever the lexer needs
+ * more input, reading continues with the open elements once it was fed.
+ *
+ * @tparam LexerT Lexer, StringLexer or PushLexer.
+ */
+template <class LexerT> class Reader {
+public:
+  using string_type = typename LexerT::string_type;
+  using event_type = BasicEvent<string_type>;
+
+  /**
+   * @brief Constructor of the reader.
+   *
+   * @param lexer The lexer to pull the tokens from.
+   */
+  Reader(LexerT lexer) : m_lexer(std::move(lexer)) {}
+
+  /**
+   * @brief Resume reading inside of open elements.
+   *
+   * @param lexer The lexer to pull the tokens from, e.g. one starting at an
+   * offset of the document.
+   * @param open, open_symbols Names and symbols of the elements that are
+   * open at the start of @p lexer, outermost first.
+   */
+  Reader(LexerT lexer, std::vector<string_type> open,
+         std::vector<Symbol> open_symbols)
+      : m_lexer(std::move(lexer)), m_open(std::move(open)),
+        m_open_symbols(std::move(open_symbols)) {}
+
+  /**
+   * @brief Read the next event.
+   *
+   * @return The next event or an empty optional at the end of the input.
+   * @throws std::runtime_error On an end tag without open element.
+   */
+  std::optional<event_type> next() {
+    while (auto token = m_lexer.next()) {
+      if (auto const start = std::get_if<BasicStartTagBegin<string_type>>(
+              &*token)) {
+        m_open.push_back(start->name);
+        m_open_symbols.push_back(start->symbol);
+        return event_type{std::move(*start)};
+      }
+      if (auto const attr =
+              std::get_if<BasicAttribute<string_type>>(&*token)) {
+        return event_type{std::move(*attr)};
+      }
+      if (auto const cont = std::get_if<BasicContent<string_type>>(&*token)) {
+        return event_type{std::move(*cont)};
+      }
+      if (std::holds_alternative<CloseTag>(*token) or
+          std::holds_alternative<BasicEndTag<string_type>>(*token)) {
+        if (m_open.empty())
+          throw std::runtime_error("Unexpected end tag");
+        auto name = std::move(m_open.back());
+        auto const symbol = m_open_symbols.back();
+        m_open.pop_back();
+        m_open_symbols.pop_back();
+        return event_type{BasicEndTag<string_type>{std::move(name), symbol}};
+      }
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Number of currently open elements.
+   *
+   * After a StartTagBegin event this is the nesting level of the started
+   * element plus one, after an EndTag event it is the nesting level of the
+   * closed element.
+   */
+  std::size_t depth() const { return m_open.size(); }
+
+  /** @brief Names of the currently open elements, outermost first. */
+  std::vector<string_type> const &open_elements() const { return m_open; }
+
+  /** @brief Symbols of the currently open elements, outermost first. */
+  std::vector<Symbol> const &open_symbols() const { return m_open_symbols; }
+
+  /** @brief The lexer the tokens are pulled from. */
+  LexerT const &lexer() const { return m_lexer; }
+
+  /** @brief The lexer the tokens are pulled from, e.g. to feed a PushLexer. */
+  LexerT &lexer() { return m_lexer; }
+
+private:
+  LexerT m_lexer;
+  std::vector<string_type> m_open;
+  std::vector<Symbol> m_open_symbols;
+};
+
+/**
+ * @brief Call @p visitor on every event read by @p reader.
+ *
+ * @param reader The reader to pull the events from.
+ * @param visitor Callable that accepts all alternatives of the event type.
+ */
+template <class LexerT, class Visitor>
+void for_each_event(Reader<LexerT> &reader, Visitor &&visitor) {
+  while (auto event = reader.next())
+    std::visit(visitor, *event);
+}
+
+} // namespace XML
+
+#endif
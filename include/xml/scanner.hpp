@@ -0,0 +1,273 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "simd.hpp"
+
+/** @file scanner.hpp
+ *  @brief This file contains the vectorized structural character scanner.
+ */
+
+namespace XML {
+
+/**
+ * @brief Positions of the structural characters of a block of 64 chars.
+ *
+ * Bit i of a mask is set if the char at offset i of the block belongs to the
+ * respective character class. Chars past the end of the buffer are treated
+ * as '\0'.
+ */
+struct BlockMasks {
+  static constexpr std::size_t block_size = 64;
+
+  /** '<' */
+  std::uint64_t lt;
+  /** '=' */
+  std::uint64_t eq;
+  /** '"' */
+  std::uint64_t quote;
+  /** Everything except [A-Za-z]. */
+  std::uint64_t non_alpha;
+  /**
+   * Chars the lexer can start a token with: '<', '>', '/' and [A-Za-z].
+   * Skipping to the next of these skips the whitespace between tokens.
+   */
+  std::uint64_t token;
+};
+
+namespace detail {
+
+/** @brief [A-Za-z], i.e. std::isalpha in the "C" locale. */
+constexpr bool is_alpha(char c) {
+  auto const lower = static_cast<unsigned char>(c | 0x20);
+  return lower >= 'a' and lower <= 'z';
+}
+
+/** @brief [A-Za-z0-9], i.e. std::isalnum in the "C" locale. */
+constexpr bool is_alnum(char c) { return is_alpha(c) or (c >= '0' and c <= '9'); }
+
+/** Signature of the kernels classifying a block of 64 chars. */
+using block_kernel = BlockMasks (*)(char const *);
+
+/** @brief Classify a block char by char. */
+inline BlockMasks block_masks_scalar(char const *block) {
+  BlockMasks masks{};
+  for (std::size_t i = 0; i < BlockMasks::block_size; ++i) {
+    auto const c = block[i];
+    auto const bit = std::uint64_t{1} << i;
+    auto const alpha = is_alpha(c);
+    if (c == '<')
+      masks.lt |= bit;
+    if (c == '=')
+      masks.eq |= bit;
+    if (c == '"')
+      masks.quote |= bit;
+    if (not alpha)
+      masks.non_alpha |= bit;
+    if (alpha or c == '<' or c == '>' or c == '/')
+      masks.token |= bit;
+  }
+  return masks;
+}
+
+#ifdef YAXP_X86_SIMD
+
+/** @brief Classify a block 16 chars at a time. */
+inline BlockMasks block_masks_sse2(char const *block) {
+  BlockMasks masks{};
+  for (std::size_t i = 0; i < BlockMasks::block_size; i += 16) {
+    auto const x =
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(block + i));
+    auto const eq = [x](char c) {
+      return _mm_cmpeq_epi8(x, _mm_set1_epi8(c));
+    };
+    auto const lt = eq('<');
+    // [A-Za-z] iff (c | 0x20) - 'a' <= 25 as unsigned char
+    auto const offset = _mm_sub_epi8(_mm_or_si128(x, _mm_set1_epi8(0x20)),
+                                     _mm_set1_epi8('a'));
+    auto const alpha =
+        _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(25)), offset);
+    auto const token =
+        _mm_or_si128(_mm_or_si128(alpha, lt), _mm_or_si128(eq('>'), eq('/')));
+    auto const to_bits = [i](__m128i v) {
+      return std::uint64_t{static_cast<std::uint16_t>(_mm_movemask_epi8(v))}
+             << i;
+    };
+    masks.lt |= to_bits(lt);
+    masks.eq |= to_bits(eq('='));
+    masks.quote |= to_bits(eq('"'));
+    masks.non_alpha |= ~to_bits(alpha) & (std::uint64_t{0xffff} << i);
+    masks.token |= to_bits(token);
+  }
+  return masks;
+}
+
+/**
+ * @brief Classify a block 32 chars at a time.
+ *
+ * Lambdas do not inherit the target attribute, hence no helpers are used.
+ */
+__attribute__((target("avx2"))) inline BlockMasks
+block_masks_avx2(char const *block) {
+  BlockMasks masks{};
+  for (std::size_t i = 0; i < BlockMasks::block_size; i += 32) {
+    auto const x =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(block + i));
+    auto const lt = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('<'));
+    auto const eq = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('='));
+    auto const quote = _mm256_cmpeq_epi8(x, _mm256_set1_epi8('"'));
+    auto const gt_slash =
+        _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('>')),
+                        _mm256_cmpeq_epi8(x, _mm256_set1_epi8('/')));
+    auto const offset = _mm256_sub_epi8(
+        _mm256_or_si256(x, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+    auto const alpha = _mm256_cmpeq_epi8(
+        _mm256_min_epu8(offset, _mm256_set1_epi8(25)), offset);
+    auto const token = _mm256_or_si256(_mm256_or_si256(alpha, lt), gt_slash);
+    masks.lt |= std::uint64_t{static_cast<std::uint32_t>(
+                    _mm256_movemask_epi8(lt))}
+                << i;
+    masks.eq |= std::uint64_t{static_cast<std::uint32_t>(
+                    _mm256_movemask_epi8(eq))}
+                << i;
+    masks.quote |= std::uint64_t{static_cast<std::uint32_t>(
+                       _mm256_movemask_epi8(quote))}
+                   << i;
+    masks.non_alpha |= std::uint64_t{static_cast<std::uint32_t>(
+                           ~_mm256_movemask_epi8(alpha))}
+                       << i;
+    masks.token |= std::uint64_t{static_cast<std::uint32_t>(
+                       _mm256_movemask_epi8(token))}
+                   << i;
+  }
+  return masks;
+}
+
+#endif
+
+/**
+ * @brief The fastest kernel supported by the executing CPU.
+ *
+ * The choice is made once at runtime.
+ */
+inline block_kernel default_block_kernel() {
+#ifdef YAXP_X86_SIMD
+  static block_kernel const kernel = __builtin_cpu_supports("avx2")
+                                         ? &block_masks_avx2
+                                         : &block_masks_sse2;
+  return kernel;
+#else
+  return &block_masks_scalar;
+#endif
+}
+
+/** @brief Index of the lowest set bit of a non-zero mask. */
+inline std::size_t lowest_bit(std::uint64_t mask) {
+#ifdef __GNUC__
+  return static_cast<std::size_t>(__builtin_ctzll(mask));
+#else
+  std::size_t i = 0;
+  while ((mask & 1) == 0) {
+    mask >>= 1;
+    ++i;
+  }
+  return i;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * @brief Structural index of a buffer that is built block by block.
+ *
+ * The buffer is classified in blocks of 64 chars by a vectorized kernel, the
+ * masks of the current block are kept so that all lookups within a block
+ * are bit operations. Lookups are expected to move front to back, which is
+ * what a lexer does; going back to an earlier block reclassifies it.
+ */
+class StructuralIndex {
+public:
+  /** Selects one of the character classes of BlockMasks. */
+  using char_class = std::uint64_t BlockMasks::*;
+
+  /**
+   * @brief Constructor of the structural index.
+   *
+   * @param buffer The buffer to index, it has to outlive the index.
+   * @param kernel The kernel to classify the blocks with.
+   */
+  explicit StructuralIndex(
+      std::string_view buffer,
+      detail::block_kernel kernel = detail::default_block_kernel())
+      : m_buffer(buffer), m_kernel(kernel) {}
+
+  std::string_view buffer() const { return m_buffer; }
+
+  /**
+   * @brief Find the first char of class @p cls at or after @p pos.
+   *
+   * @return The position of the char or the size of the buffer if there is
+   * none.
+   */
+  std::size_t find(std::size_t pos, char_class cls) {
+    // fast path, the char is in the current block
+    auto const block = pos / BlockMasks::block_size;
+    if (block == m_block) {
+      auto const mask = m_masks.*cls &
+                        (~std::uint64_t{0} << (pos % BlockMasks::block_size));
+      if (mask != 0)
+        return std::min(block * BlockMasks::block_size +
+                            detail::lowest_bit(mask),
+                        m_buffer.size());
+    }
+    return find_in_next_blocks(pos, cls);
+  }
+
+  /** @brief The masks of the block with index @p block. */
+  BlockMasks const &masks(std::size_t block) {
+    if (block != m_block) {
+      auto const begin = block * BlockMasks::block_size;
+      if (begin + BlockMasks::block_size <= m_buffer.size()) {
+        m_masks = m_kernel(m_buffer.data() + begin);
+      } else {
+        // the tail is padded with '\0', which is in no class but non_alpha
+        char tail[BlockMasks::block_size] = {};
+        std::memcpy(tail, m_buffer.data() + begin, m_buffer.size() - begin);
+        m_masks = m_kernel(tail);
+      }
+      m_block = block;
+    }
+    return m_masks;
+  }
+
+private:
+  std::size_t find_in_next_blocks(std::size_t pos, char_class cls) {
+    auto const size = m_buffer.size();
+    if (pos >= size)
+      return size;
+    auto block = pos / BlockMasks::block_size;
+    auto mask = masks(block).*cls &
+                (~std::uint64_t{0} << (pos % BlockMasks::block_size));
+    while (mask == 0) {
+      if (++block * BlockMasks::block_size >= size)
+        return size;
+      mask = masks(block).*cls;
+    }
+    return std::min(block * BlockMasks::block_size + detail::lowest_bit(mask),
+                    size);
+  }
+
+  std::string_view m_buffer;
+  detail::block_kernel m_kernel;
+  std::size_t m_block = static_cast<std::size_t>(-1);
+  BlockMasks m_masks{};
+};
+
+} // namespace XML
+
+#endif
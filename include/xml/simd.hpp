@@ -0,0 +1,18 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+/** @file simd.hpp
+ *  @brief This file contains the detection of the vector instructions the
+ *  kernels of the scanner and the reductions are compiled for.
+ *
+ *  YAXP_X86_SIMD is defined if the SSE2 and AVX2 kernels can be compiled,
+ *  i.e. with GCC or Clang on x86-64. SSE2 is part of x86-64, whether AVX2 is
+ *  supported is checked at runtime before its kernels are called.
+ */
+
+#if defined(__GNUC__) and defined(__x86_64__)
+#define YAXP_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#endif
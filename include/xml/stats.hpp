@@ -0,0 +1,204 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/** @file stats.hpp
+ *  @brief This file contains the instrumentation of the processing stages.
+ *
+ *  The instrumentation is compiled in if YAXP_STATS is defined, i.e. with
+ *  the CMake option ENABLE_STATS. Otherwise the YAXP_STATS_* macros expand
+ *  to nothing.
+ */
+
+namespace XML {
+
+/**
+ * @brief Process wide counters and stage timers.
+ *
+ * All updates are atomic, so the stats can be collected from several
+ * threads. The timers sum up the time spent in a stage over all threads.
+ */
+class Stats {
+public:
+  enum Counter : std::size_t {
+    bytes_read,
+    tokens,
+    elements,
+    filter_evaluations,
+    conversions,
+    arena_blocks,
+    allocations,
+    counter_count
+  };
+
+  enum Timer : std::size_t { lex, parse, filter, convert, output, timer_count };
+
+  static constexpr std::array<std::string_view, counter_count> counter_names =
+      {"bytes_read",  "tokens",       "elements",   "filter_evaluations",
+       "conversions", "arena_blocks", "allocations"};
+
+  static constexpr std::array<std::string_view, timer_count> timer_names = {
+      "lex", "parse", "filter", "convert", "output"};
+
+  /** @brief The stats of the process. */
+  static Stats &instance() {
+    static Stats stats;
+    return stats;
+  }
+
+  void add(Counter counter, std::uint64_t value) {
+    m_counters[counter].fetch_add(value, std::memory_order_relaxed);
+  }
+
+  void add(Timer timer, std::chrono::nanoseconds duration) {
+    m_timers[timer].fetch_add(static_cast<std::uint64_t>(duration.count()),
+                              std::memory_order_relaxed);
+  }
+
+  /** @brief Record that operation @p name matched @p count elements. */
+  void add_matches(std::string name, std::uint64_t count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_matches.emplace_back(std::move(name), count);
+  }
+
+  std::uint64_t count(Counter counter) const {
+    return m_counters[counter].load(std::memory_order_relaxed);
+  }
+
+  std::chrono::nanoseconds time(Timer timer) const {
+    return std::chrono::nanoseconds(
+        m_timers[timer].load(std::memory_order_relaxed));
+  }
+
+  /** @brief The recorded matches per operation in recording order. */
+  std::vector<std::pair<std::string, std::uint64_t>> matches() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_matches;
+  }
+
+  void reset() {
+    for (auto &counter : m_counters)
+      counter.store(0, std::memory_order_relaxed);
+    for (auto &timer : m_timers)
+      timer.store(0, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_matches.clear();
+  }
+
+  /**
+   * @brief Write a human readable summary.
+   *
+   * @param stream Stream to write to.
+   * @param total The wall time of the whole run.
+   */
+  void write_summary(std::ostream &stream,
+                     std::chrono::nanoseconds total) const {
+    auto const ms = [](std::chrono::nanoseconds t) {
+      return static_cast<double>(t.count()) / 1e6;
+    };
+    stream << std::fixed << std::setprecision(3);
+    stream << "stage times [ms]:\n";
+    for (std::size_t i = 0; i < timer_count; ++i) {
+      stream << "  " << std::left << std::setw(20) << timer_names[i]
+             << std::right << std::setw(14) << ms(time(Timer(i))) << "\n";
+    }
+    stream << "  " << std::left << std::setw(20) << "total" << std::right
+           << std::setw(14) << ms(total) << "\n";
+    stream << "counters:\n";
+    for (std::size_t i = 0; i < counter_count; ++i) {
+      stream << "  " << std::left << std::setw(20) << counter_names[i]
+             << std::right << std::setw(14) << count(Counter(i)) << "\n";
+    }
+    stream << "matches per operation:\n";
+    for (auto const &[name, count] : matches()) {
+      stream << "  " << std::left << std::setw(20) << name << std::right
+             << std::setw(14) << count << "\n";
+    }
+  }
+
+  /**
+   * @brief Write the stats as JSON object.
+   *
+   * @param stream Stream to write to.
+   * @param total The wall time of the whole run.
+   */
+  void write_json(std::ostream &stream, std::chrono::nanoseconds total) const {
+    stream << "{\"times_ns\": {";
+    for (std::size_t i = 0; i < timer_count; ++i)
+      stream << '"' << timer_names[i] << "\": " << time(Timer(i)).count()
+             << ", ";
+    stream << "\"total\": " << total.count() << "}, \"counters\": {";
+    for (std::size_t i = 0; i < counter_count; ++i) {
+      stream << (i == 0 ? "" : ", ") << '"' << counter_names[i]
+             << "\": " << count(Counter(i));
+    }
+    stream << "}, \"matches\": {";
+    auto const all_matches = matches();
+    for (std::size_t i = 0; i < all_matches.size(); ++i) {
+      stream << (i == 0 ? "" : ", ") << '"';
+      for (auto const c : all_matches[i].first) {
+        if (c == '"' or c == '\\')
+          stream << '\\';
+        stream << c;
+      }
+      stream << "\": " << all_matches[i].second;
+    }
+    stream << "}}\n";
+  }
+
+private:
+  Stats() = default;
+
+  std::array<std::atomic<std::uint64_t>, counter_count> m_counters{};
+  std::array<std::atomic<std::uint64_t>, timer_count> m_timers{};
+  mutable std::mutex m_mutex;
+  std::vector<std::pair<std::string, std::uint64_t>> m_matches;
+};
+
+/**
+ * @brief Adds the time between its construction and destruction to a timer.
+ */
+class ScopedTimer {
+public:
+  explicit ScopedTimer(Stats::Timer timer)
+      : m_timer(timer), m_begin(std::chrono::steady_clock::now()) {}
+
+  ScopedTimer(ScopedTimer const &) = delete;
+  ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+  ~ScopedTimer() {
+    Stats::instance().add(m_timer, std::chrono::steady_clock::now() - m_begin);
+  }
+
+private:
+  Stats::Timer m_timer;
+  std::chrono::steady_clock::time_point m_begin;
+};
+
+} // namespace XML
+
+#ifdef YAXP_STATS
+/** Add @p value to the counter XML::Stats::counter. */
+#define YAXP_STATS_COUNT(counter, value)                                       \
+  ::XML::Stats::instance().add(::XML::Stats::counter, (value))
+/** Time the rest of the enclosing scope in the timer XML::Stats::timer. */
+#define YAXP_STATS_TIMER(timer)                                                \
+  ::XML::ScopedTimer const yaxp_stats_timer_##timer(::XML::Stats::timer)
+#else
+#define YAXP_STATS_COUNT(counter, value) static_cast<void>(0)
+#define YAXP_STATS_TIMER(timer) static_cast<void>(0)
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef SYMBOLS_HPP
+#define SYMBOLS_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "arena.hpp"
+
+/** @file symbols.hpp
+ *  @brief This file contains the symbol table interning tag and attribute
+ *  names.
+ */
+
+namespace XML {
+
+/** Small integer ID of an interned name. */
+using Symbol = std::uint32_t;
+
+/** Symbol of names that were not interned. */
+constexpr Symbol no_symbol = std::numeric_limits<Symbol>::max();
+
+/**
+ * @brief Table of interned names.
+ *
+ * Every distinct name is stored once and identified by a Symbol, the IDs
+ * are handed out consecutively starting at zero. Names with the same symbol
+ * in the same table are equal, so names can be compared as integers. A
+ * table can be shared by a lexer and the documents built from its tokens.
+ * Interning is not thread-safe, looking up names concurrently is.
+ */
+class SymbolTable {
+public:
+  /**
+   * @brief The symbol of @p name, it is created on first use.
+   */
+  Symbol intern(std::string_view name) {
+    auto const it = m_ids.find(name);
+    if (it != m_ids.end())
+      return it->second;
+    auto const symbol = static_cast<Symbol>(m_names.size());
+    auto const copy = m_strings.copy(name);
+    m_ids.emplace(copy, symbol);
+    m_names.push_back(copy);
+    return symbol;
+  }
+
+  /**
+   * @brief The symbol of @p name.
+   *
+   * @return The symbol or no_symbol if @p name was not interned.
+   */
+  Symbol find(std::string_view name) const {
+    auto const it = m_ids.find(name);
+    return it != m_ids.end() ? it->second : no_symbol;
+  }
+
+  /**
+   * @brief The name of @p symbol.
+   *
+   * @return A view valid for the lifetime of the table.
+   */
+  std::string_view name(Symbol symbol) const {
+    assert(symbol < m_names.size());
+    return m_names[symbol];
+  }
+
+  /** @brief Number of interned names. */
+  std::size_t size() const { return m_names.size(); }
+
+private:
+  Arena m_strings;
+  std::unordered_map<std::string_view, Symbol> m_ids;
+  std::vector<std::string_view> m_names;
+};
+
+} // namespace XML
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/** @file thread_pool.hpp
+ *  @brief This file contains the thread pool used for parallel processing.
+ */
+
+namespace XML {
+
+/**
+ * @brief Fixed number of worker threads executing submitted tasks.
+ *
+ * Every worker owns a task queue. Tasks submitted by a worker go to its own
+ * queue, other tasks are distributed round robin. A worker takes the newest
+ * task of its own queue and, once that is empty, steals the oldest task of
+ * the other queues, so unevenly sized tasks are balanced between workers.
+ */
+class ThreadPool {
+public:
+  /**
+   * @brief Start the worker threads.
+   *
+   * @param threads Number of workers, at least one is started.
+   */
+  explicit ThreadPool(std::size_t threads) {
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; ++i)
+      m_queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 0; i < threads; ++i)
+      m_workers.emplace_back([this, i]() { work(i); });
+  }
+
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+
+  /** @brief Finish all submitted tasks and join the workers. */
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers)
+      worker.join();
+  }
+
+  std::size_t size() const { return m_workers.size(); }
+
+  /**
+   * @brief Run @p task on one of the workers.
+   *
+   * @return Future of the result of @p task, it holds any thrown exception.
+   */
+  template <class F> std::future<std::invoke_result_t<F>> submit(F task) {
+    auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+        std::move(task));
+    auto result = packaged->get_future();
+    auto &queue = *m_queues[queue_index()];
+    {
+      // count the task before it can be popped, so m_pending never wraps
+      std::lock_guard<std::mutex> pending_lock(m_mutex);
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      ++m_pending;
+      queue.tasks.emplace_back([packaged]() { (*packaged)(); });
+    }
+    m_wake.notify_one();
+    return result;
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /** The pool and index of the worker running on the calling thread. */
+  struct Worker {
+    ThreadPool const *pool = nullptr;
+    std::size_t index = 0;
+  };
+
+  static Worker &current_worker() {
+    thread_local Worker worker;
+    return worker;
+  }
+
+  std::size_t queue_index() {
+    auto const &worker = current_worker();
+    if (worker.pool == this)
+      return worker.index;
+    return m_next_queue.fetch_add(1, std::memory_order_relaxed) %
+           m_queues.size();
+  }
+
+  /** @brief Take the next task of worker @p index, steal if there is none. */
+  bool pop(std::size_t index, std::function<void()> &task) {
+    {
+      auto &own = *m_queues[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (not own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < m_queues.size(); ++i) {
+      auto &other = *m_queues[(index + i) % m_queues.size()];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (not other.tasks.empty()) {
+        task = std::move(other.tasks.front());
+        other.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void work(std::size_t index) {
+    current_worker() = {this, index};
+    while (true) {
+      std::function<void()> task;
+      if (pop(index, task)) {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          --m_pending;
+        }
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]() { return m_stop or m_pending != 0; });
+      if (m_pending == 0)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  std::atomic<std::size_t> m_next_queue{0};
+  /** Number of submitted tasks that were not taken by a worker yet. */
+  std::size_t m_pending = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+};
+
+} // namespace XML
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef WRITER_HPP
+#define WRITER_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser.hpp"
+
+/** @file writer.hpp
+ *  @brief This file contains the buffered writer of XML documents.
+ */
+
+namespace XML {
+
+/**
+ * @brief Buffered writer of XML documents.
+ *
+ * The output is collected in a buffer that is handed to the stream in large
+ * blocks. Indentation is copied from a precomputed run of spaces and numbers
+ * are formatted with std::to_chars, so writing an element allocates nothing
+ * once the buffer has grown. Elements are laid out like
+ *
+ *     <name key="value">
+ *         content
+ *       <child>
+ *       </child>
+ *     </name>
+ *
+ * where the tags are indented by two and the content by four spaces per
+ * nesting level.
+ */
+class Writer {
+public:
+  /**
+   * @brief Constructor of the writer.
+   *
+   * @param output Stream the buffer is flushed to.
+   * @param block_size The buffer is flushed once it holds this many bytes.
+   */
+  explicit Writer(std::ostream &output, std::size_t block_size = 64 * 1024)
+      : m_output(output), m_block_size(block_size) {
+    m_buffer.reserve(block_size + indentation.size());
+  }
+
+  Writer(Writer const &) = delete;
+  Writer &operator=(Writer const &) = delete;
+
+  /** @brief Flush the remaining output. */
+  ~Writer() { flush(); }
+
+  /** @brief Hand the buffered output to the stream. */
+  void flush() {
+    m_output.write(m_buffer.data(),
+                   static_cast<std::streamsize>(m_buffer.size()));
+    m_buffer.clear();
+  }
+
+  /** @brief Write the start of the start tag of an element. */
+  void start_element(std::string_view name, std::size_t nesting_level) {
+    indent(2 * nesting_level);
+    put('<');
+    put(name);
+  }
+
+  /** @brief Write an attribute of the current start tag. */
+  void attribute(std::string_view key, std::string_view value) {
+    put(' ');
+    put(key);
+    put("=\"");
+    put(value);
+    put('"');
+  }
+
+  /** @brief Close the current start tag. */
+  void end_start_tag() { put(">\n"); }
+
+  /** @brief Write the content of an element on its own line. */
+  void content(std::string_view text, std::size_t nesting_level) {
+    indent(4 * nesting_level);
+    put(text);
+    put('\n');
+  }
+
+  /**
+   * @brief Write a number in fixed notation as content of an element.
+   *
+   * @param value The number.
+   * @param precision Number of digits after the decimal point, at most 100.
+   * @param nesting_level The nesting level of the element.
+   */
+  void content(double value, int precision, std::size_t nesting_level) {
+    indent(4 * nesting_level);
+    put_fixed(value, precision);
+    put('\n');
+  }
+
+  /** @brief Write the end tag of an element, without line break. */
+  void end_element(std::string_view name, std::size_t nesting_level) {
+    indent(2 * nesting_level);
+    put("</");
+    put(name);
+    put('>');
+  }
+
+  /** @brief End the line, e.g. after the end tag of a child. */
+  void newline() { put('\n'); }
+
+  /**
+   * @brief Write @p root and all of its descendants.
+   *
+   * The tree is walked with an explicit stack, so deeply nested documents
+   * do not overflow the call stack. There is no line break after the end
+   * tag of @p root.
+   */
+  void write(XML_Element const &root) {
+    m_stack.clear();
+    open(root);
+    while (not m_stack.empty()) {
+      auto &top = m_stack.back();
+      if (auto const child = top.next_child) {
+        top.next_child = child->next_sibling;
+        open(*child);
+        continue;
+      }
+      end_element(top.elem->name, top.elem->nesting_level);
+      m_stack.pop_back();
+      if (not m_stack.empty())
+        newline();
+    }
+  }
+
+  /** @brief Write the root of @p doc, i.e. the whole document. */
+  void write(XML_Doc const &doc) { write(*doc.back()); }
+
+private:
+  /** Spaces the indentation is copied from. */
+  static constexpr std::string_view indentation =
+      "                                                                ";
+
+  struct Frame {
+    XML_Element const *elem;
+    XML_Element const *next_child;
+  };
+
+  void open(XML_Element const &elem) {
+    start_element(elem.name, elem.nesting_level);
+    for (auto const &attr : elem.attributes)
+      attribute(attr.key_val.first, attr.key_val.second);
+    end_start_tag();
+    if (not elem.content.empty())
+      content(elem.content, elem.nesting_level);
+    m_stack.push_back({&elem, elem.first_child});
+  }
+
+  void put(char c) {
+    m_buffer.push_back(c);
+    if (m_buffer.size() >= m_block_size)
+      flush();
+  }
+
+  void put(std::string_view str) {
+    m_buffer.append(str);
+    if (m_buffer.size() >= m_block_size)
+      flush();
+  }
+
+  void indent(std::size_t width) {
+    while (width > 0) {
+      auto const chunk = std::min(width, indentation.size());
+      put(indentation.substr(0, chunk));
+      width -= chunk;
+    }
+  }
+
+  void put_fixed(double value, int precision) {
+    assert(precision >= 0 and precision <= 100);
+    // enough for the integral digits of any double and the precision
+    char chars[512];
+#if defined(__cpp_lib_to_chars)
+    auto const result = std::to_chars(chars, chars + sizeof(chars), value,
+                                      std::chars_format::fixed, precision);
+    put({chars, static_cast<std::size_t>(result.ptr - chars)});
+#else
+    auto const size =
+        std::snprintf(chars, sizeof(chars), "%.*f", precision, value);
+    put({chars, static_cast<std::size_t>(size)});
+#endif
+  }
+
+  std::ostream &m_output;
+  std::size_t m_block_size;
+  std::string m_buffer;
+  std::vector<Frame> m_stack;
+};
+
+} // namespace XML
+
+#endif
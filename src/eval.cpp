@@ -1,19 +1,348 @@
-
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
+#include "binary_document.hpp"
 #include "eval.hpp"
+#include "incremental.hpp"
+#include "lazy_document.hpp"
+#include "mapped_file.hpp"
+#include "parallel_parser.hpp"
+#include "result_cache.hpp"
+#include "stats.hpp"
 
-int main(int argc, char **argv) {
-  if (argc != 3) {
-    std::cout << "Usage: " << argv[0] << " data.xml operations.xml\n";
-    std::exit(1);
+namespace {
+
+/**
+ * @brief Parse the XML file at @p path.
+ *
+ * Regular files are memory mapped and lexed in place, everything else (e.g.
+ * pipes) is read through a stream.
+ */
+XML::XML_Doc parse_file(std::string const &path) {
+  if (std::filesystem::is_regular_file(path)) {
+    XML::MappedFile const file(path);
+    return XML::StringParser(XML::StringLexer(file.view()).tokenize()).parse();
   }
+  std::ifstream stream(path, std::ios::in);
+  return XML::Parser(XML::Lexer(stream).tokenize()).parse();
+}
 
-  // read xml files
-  std::ifstream data_stream(argv[1], std::ios::in);
-  std::ifstream op_stream(argv[2], std::ios::in);
+/**
+ * @brief Evaluate @p operations on the data read from the pipe or socket at
+ * @p data_path.
+ *
+ * The data is evaluated chunk by chunk as it arrives instead of waiting for
+ * the whole payload.
+ */
+void evaluate_pipe(std::string const &data_path,
+                   std::vector<Operation::Operation> const &operations) {
+  struct Descriptor {
+    int fd;
+    ~Descriptor() { ::close(fd); }
+  } const file{::open(data_path.c_str(), O_RDONLY)};
+  if (file.fd < 0)
+    throw std::runtime_error("Could not open file: " + data_path);
+  Operation::PushEvaluator evaluator(operations);
+  std::vector<char> chunk(64 * 1024);
+  ssize_t size = 0;
+  while ((size = ::read(file.fd, chunk.data(), chunk.size())) != 0) {
+    if (size < 0 and errno == EINTR)
+      continue;
+    if (size < 0)
+      throw std::runtime_error("Could not read file: " + data_path);
+    evaluator.feed({chunk.data(), static_cast<std::size_t>(size)});
+  }
+  evaluator.finish(std::cout);
+}
+
+/** @brief Evaluate @p operations on the data file at @p data_path. */
+void evaluate(std::string const &data_path,
+              std::vector<Operation::Operation> const &operations,
+              std::size_t threads, bool lazy) {
   // Evaluate and write resulting XML to standard out.
-  Operation::eval(data_stream, op_stream, std::cout);
-}
\ No newline at end of file
+  if (std::filesystem::is_regular_file(data_path)) {
+    XML::MappedFile const file(data_path);
+    if (lazy) {
+      Operation::eval(XML::LazyDocument(file.view()), operations, std::cout);
+    } else if (threads > 1) {
+      XML::ThreadPool pool(threads);
+      auto const data_doc = XML::parse_parallel(
+          file.view(), pool, 1 << 20, Operation::make_projection(operations));
+      Operation::eval(data_doc, operations, pool, std::cout);
+    } else {
+      Operation::eval_stream(
+          XML::Reader<XML::StringLexer>(XML::StringLexer(
+              file.view(), std::make_shared<XML::SymbolTable>(),
+              Operation::make_projection(operations))),
+          operations, std::cout);
+    }
+  } else {
+    evaluate_pipe(data_path, operations);
+  }
+}
+
+/**
+ * @brief The binary document in @p cache if it was written for the data
+ * file at @p data_path in its current version, nullptr otherwise.
+ */
+std::unique_ptr<XML::BinaryDocument const>
+open_cache(XML::MappedFile const &cache, std::string const &data_path) {
+  std::unique_ptr<XML::BinaryDocument const> doc;
+  try {
+    doc = std::make_unique<XML::BinaryDocument const>(cache.view());
+  } catch (std::runtime_error const &) {
+    return nullptr;
+  }
+  if (doc->source_size() != std::filesystem::file_size(data_path) or
+      doc->source_time() != std::filesystem::last_write_time(data_path)
+                                .time_since_epoch()
+                                .count())
+    return nullptr;
+  return doc;
+}
+
+/**
+ * @brief Evaluate @p operations on the data file at @p data_path, which is
+ * read from the binary cache at @p cache_path.
+ *
+ * If the cache is missing or outdated the data file is parsed and the cache
+ * is written for the next run.
+ */
+void evaluate_cached(std::string const &data_path,
+                     std::string const &cache_path,
+                     std::vector<Operation::Operation> const &operations) {
+  if (std::filesystem::is_regular_file(cache_path)) {
+    XML::MappedFile const cache(cache_path);
+    if (auto const doc = open_cache(cache, data_path)) {
+      try {
+        Operation::eval(*doc, operations, std::cout);
+        return;
+      } catch (std::runtime_error const &) {
+        // the elements are checked as they are read, a corrupt cache is
+        // written again like an outdated one
+      }
+    }
+  }
+  auto const data_doc = parse_file(data_path);
+  // write to a temporary file first, readers never see a partial cache
+  auto const temporary = cache_path + ".tmp";
+  {
+    std::ofstream output(temporary, std::ios::out | std::ios::binary);
+    XML::write_binary(data_doc, output, std::filesystem::file_size(data_path),
+                      std::filesystem::last_write_time(data_path)
+                          .time_since_epoch()
+                          .count());
+  }
+  std::filesystem::rename(temporary, cache_path);
+  Operation::eval(data_doc, operations, std::cout);
+}
+
+/** @brief Path, size and modification time of the file at @p path. */
+std::string data_fingerprint(std::string const &path) {
+  return std::filesystem::canonical(path).string() + '\n' +
+         std::to_string(std::filesystem::file_size(path)) + '\n' +
+         std::to_string(
+             std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+/**
+ * @brief Evaluate @p operations on the data file at @p data_path, taking the
+ * results of unchanged operations from the result cache at @p cache_path.
+ *
+ * Only the operations that are not cached are evaluated, on the streamed
+ * data. The cache is updated and keeps at most @p capacity results. The
+ * results of grouped operations are not cached.
+ */
+void evaluate_with_result_cache(
+    std::string const &data_path, std::string const &cache_path,
+    std::size_t capacity, std::vector<Operation::Operation> const &operations) {
+  Operation::ResultCache cache(capacity);
+  {
+    std::ifstream input(cache_path, std::ios::in);
+    cache.load(input);
+  }
+  auto const fingerprint = data_fingerprint(data_path);
+  std::vector<Operation::Accumulator> accumulators(operations.size());
+  std::vector<Operation::Groups> groups(operations.size());
+  std::vector<Operation::Operation> missing;
+  std::vector<std::size_t> missing_index;
+  for (std::size_t i = 0; i < operations.size(); ++i) {
+    std::optional<Operation::Accumulator> state;
+    if (operations[i].m_group.empty())
+      state =
+          cache.find(Operation::ResultCache::key(fingerprint, operations[i]));
+    if (state) {
+      accumulators[i] = *state;
+    } else {
+      missing.push_back(operations[i]);
+      missing_index.push_back(i);
+    }
+  }
+
+  if (not missing.empty()) {
+    XML::MappedFile const file(data_path);
+    auto projection = Operation::make_projection(missing);
+    Operation::Evaluator evaluator(missing);
+    Operation::process_stream(
+        XML::Reader<XML::StringLexer>(
+            XML::StringLexer(file.view(), std::make_shared<XML::SymbolTable>(),
+                             std::move(projection))),
+        evaluator);
+    for (std::size_t j = 0; j < missing.size(); ++j) {
+      auto const &state = evaluator.accumulators()[j];
+      accumulators[missing_index[j]] = state;
+      groups[missing_index[j]] = evaluator.groups()[j];
+      if (missing[j].m_group.empty())
+        cache.insert(Operation::ResultCache::key(fingerprint, missing[j]),
+                     state);
+    }
+    auto const temporary = cache_path + ".tmp";
+    {
+      std::ofstream output(temporary, std::ios::out);
+      cache.save(output);
+    }
+    std::filesystem::rename(temporary, cache_path);
+  }
+  Operation::write_results(operations, accumulators, std::cout, groups);
+}
+
+/**
+ * @brief Evaluate @p operations on the data file at @p data_path, resuming
+ * from the state at @p state_path, which is updated for the next run.
+ */
+void evaluate_incremental(std::string const &data_path,
+                          std::string const &state_path,
+                          std::vector<Operation::Operation> const &operations) {
+  Operation::IncrementalState state;
+  {
+    std::ifstream input(state_path, std::ios::in);
+    if (input)
+      state.load(input);
+  }
+  XML::MappedFile const file(data_path);
+  auto const next = Operation::eval_incremental(
+      file.view(), operations, std::filesystem::canonical(data_path).string(),
+      state, std::cout);
+  auto const temporary = state_path + ".tmp";
+  {
+    std::ofstream output(temporary, std::ios::out);
+    next.save(output);
+  }
+  std::filesystem::rename(temporary, state_path);
+}
+
+[[noreturn]] void usage(char const *name) {
+  std::cout << "Usage: " << name
+            << " [--threads N] [--lazy] [--cache data.yxb]\n"
+               "  [--result-cache results.cache [--result-cache-size N]]\n"
+               "  [--incremental state] [--stats[=json]] data.xml "
+               "operations.xml\n";
+  std::exit(1);
+}
+
+} // namespace
+
+#ifdef YAXP_STATS
+// count the allocations of the whole program
+void *operator new(std::size_t size) {
+  YAXP_STATS_COUNT(allocations, 1);
+  if (auto const ptr = std::malloc(size == 0 ? 1 : size))
+    return ptr;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
+int main(int argc, char **argv) {
+  std::size_t threads = 1;
+  bool lazy = false;
+  std::string cache;
+  std::string result_cache;
+  std::size_t result_cache_size = 1024;
+  std::string incremental;
+  std::string stats;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string const arg = argv[i];
+    if (arg == "--threads" and i + 1 < argc) {
+      threads = std::stoul(argv[++i]);
+    } else if (arg == "--lazy") {
+      lazy = true;
+    } else if (arg == "--cache" and i + 1 < argc) {
+      cache = argv[++i];
+    } else if (arg == "--result-cache" and i + 1 < argc) {
+      result_cache = argv[++i];
+    } else if (arg == "--result-cache-size" and i + 1 < argc) {
+      result_cache_size = std::stoul(argv[++i]);
+    } else if (arg == "--incremental" and i + 1 < argc) {
+      incremental = argv[++i];
+    } else if (arg == "--stats" or arg == "--stats=json") {
+      stats = arg;
+    } else if (arg.rfind("--", 0) == 0) {
+      usage(argv[0]);
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.size() != 2 or threads == 0)
+    usage(argv[0]);
+  if ((not cache.empty() or not result_cache.empty() or
+       not incremental.empty()) and
+      not std::filesystem::is_regular_file(files[0])) {
+    std::cerr << "--cache, --result-cache and --incremental need a regular "
+                 "data file\n";
+    return 1;
+  }
+#ifndef YAXP_STATS
+  if (not stats.empty()) {
+    std::cerr << "--stats needs a build with -DENABLE_STATS=ON\n";
+    return 1;
+  }
+#endif
+
+  auto const begin = std::chrono::steady_clock::now();
+  // read the operations first, only the data fields they use are lexed
+  auto const operations = Operation::collect_operations(parse_file(files[1]));
+  auto const has_path = [](auto const &op) {
+    return op.m_compiled_path.has_value();
+  };
+  if ((lazy or not cache.empty()) and
+      std::any_of(operations.begin(), operations.end(), has_path)) {
+    std::cerr << "--lazy and --cache do not support path operations\n";
+    return 1;
+  }
+  if (not incremental.empty())
+    evaluate_incremental(files[0], incremental, operations);
+  else if (not result_cache.empty())
+    evaluate_with_result_cache(files[0], result_cache, result_cache_size,
+                               operations);
+  else if (not cache.empty())
+    evaluate_cached(files[0], cache, operations);
+  else
+    evaluate(files[0], operations, threads, lazy);
+  auto const total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - begin);
+
+  if (stats == "--stats")
+    XML::Stats::instance().write_summary(std::cerr, total);
+  else if (stats == "--stats=json")
+    XML::Stats::instance().write_json(std::cerr, total);
+}
@@ -0,0 +1,43 @@
+#include <doctest/doctest.h>
+#include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "filter.hpp"
+
+TEST_CASE("kinds") {
+  REQUIRE(XML::Filter("Berlin").kind() == XML::Filter::Kind::literal);
+  REQUIRE(XML::Filter("M.*").kind() == XML::Filter::Kind::prefix);
+  REQUIRE(XML::Filter(".*burg").kind() == XML::Filter::Kind::suffix);
+  REQUIRE(XML::Filter(".*ar.*").kind() == XML::Filter::Kind::contains);
+  REQUIRE(XML::Filter(".*n.+").kind() == XML::Filter::Kind::dfa);
+  REQUIRE(XML::Filter(".*e.*n.*").kind() == XML::Filter::Kind::dfa);
+  REQUIRE(XML::Filter("M.*?").kind() == XML::Filter::Kind::dfa);
+  REQUIRE(XML::Filter("^M.*").kind() == XML::Filter::Kind::regex);
+  REQUIRE(XML::Filter("a{2}").kind() == XML::Filter::Kind::regex);
+  REQUIRE_THROWS_AS(XML::Filter("(M"), std::regex_error);
+}
+
+TEST_CASE("same matches as std::regex") {
+  std::vector<std::string> const patterns = {
+      "",         "Berlin",      "M.*",          ".*burg",      ".*ar.*",
+      ".*",       ".*n.+",       ".*e.*n.*",     "M.*?",        "[A-M].*",
+      "[^M].*",   "(Ber|Ham).*", "(?:M|B)\\w+",  ".*\\s.*",     "\\D+",
+      "a?b+c*",   "[a-c-]+",     ".*\\..*",      "Washington DC", "^M.*",
+      "M.*$",     "(a|b){2}",    ".*(ch|g)(en)?"};
+  std::vector<std::string> const values = {
+      "",          "Berlin",     "Moskau",   "Hamburg",    "Regensburg",
+      "München",   "Mainz",      "Stuttgart", "Washington DC", "M",
+      "Mar\nburg", "ab",         "abbc",     "b",          "--ac",
+      "1.5",       "12",         "ba",       "burg\r",     "Ber lin"};
+  for (auto const &pattern : patterns) {
+    XML::Filter const filter(pattern);
+    std::regex const regex(pattern);
+    for (auto const &value : values) {
+      CAPTURE(pattern);
+      CAPTURE(value);
+      REQUIRE(filter(value) == std::regex_match(value, regex));
+    }
+  }
+}
@@ -1,8 +1,11 @@
 #include <doctest/doctest.h>
 #include <fstream>
+#include <sstream>
 #include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
 
+#include "lazy_document.hpp"
 #include "lexer.hpp"
+#include "mapped_file.hpp"
 
 /* clang-format off */
 /* we expect the following tokens with their respective values
@@ -192,4 +195,180 @@ TEST_CASE("operations") {
   REQUIRE(attr.key_val.second == ".*e.*n.*");
   REQUIRE(std::holds_alternative<XML::CloseTag>(tokens[29]));
   REQUIRE(std::get<XML::EndTag>(tokens[30]).name == "operations");
-}
\ No newline at end of file
+}
+
+namespace {
+/* Compare the tokens of the stream lexer and the buffer lexer. */
+template <class String>
+void require_same_tokens(std::vector<XML::Token> const &expected,
+                         std::vector<XML::BasicToken<String>> const &tokens) {
+  REQUIRE(expected.size() == tokens.size());
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    REQUIRE(expected[i].index() == tokens[i].index());
+    if (auto const t = std::get_if<XML::StartTagBegin>(&expected[i]))
+      REQUIRE(std::get<0>(tokens[i]).name == t->name);
+    if (auto const t = std::get_if<XML::Attribute>(&expected[i])) {
+      REQUIRE(std::get<3>(tokens[i]).key_val.first == t->key_val.first);
+      REQUIRE(std::get<3>(tokens[i]).key_val.second == t->key_val.second);
+    }
+    if (auto const t = std::get_if<XML::Content>(&expected[i]))
+      REQUIRE(std::get<4>(tokens[i]).content == t->content);
+    if (auto const t = std::get_if<XML::EndTag>(&expected[i]))
+      REQUIRE(std::get<5>(tokens[i]).name == t->name);
+  }
+}
+} // namespace
+
+TEST_CASE("string lexer") {
+  for (auto const path :
+       {"../../data/data.xml", "../../data/operations.xml"}) {
+    std::ifstream istrm(path, std::ios::in);
+    REQUIRE(istrm.is_open());
+    auto const expected = XML::Lexer(istrm).tokenize();
+    XML::MappedFile const file(path);
+    XML::StringLexer lexer(file.view());
+    require_same_tokens(expected, lexer.tokenize());
+  }
+}
+
+TEST_CASE("projection") {
+  auto projection = std::make_shared<XML::Projection>();
+  projection->add_attribute("name");
+  projection->add_content("area");
+  std::ifstream istrm("../../data/data.xml", std::ios::in);
+  REQUIRE(istrm.is_open());
+  auto const all = XML::Lexer(istrm).tokenize();
+  istrm.clear();
+  istrm.seekg(0);
+  auto const expected = XML::Lexer(istrm, nullptr, projection).tokenize();
+  XML::MappedFile const file("../../data/data.xml");
+  XML::StringLexer lexer(file.view(), nullptr, projection);
+  auto const tokens = lexer.tokenize();
+  require_same_tokens(expected, tokens);
+
+  // the projection drops exactly the other attributes and contents
+  std::vector<XML::Token> projected;
+  std::string tag;
+  for (auto const &token : all) {
+    if (auto const start = std::get_if<XML::StartTagBegin>(&token))
+      tag = start->name;
+    if (auto const attr = std::get_if<XML::Attribute>(&token);
+        attr and attr->key_val.first != "name")
+      continue;
+    if (std::holds_alternative<XML::Content>(token) and tag != "area")
+      continue;
+    projected.push_back(token);
+  }
+  REQUIRE(projected.size() < all.size());
+  require_same_tokens(projected, tokens);
+}
+
+TEST_CASE("push lexer") {
+  auto projection = std::make_shared<XML::Projection>();
+  projection->add_attribute("name");
+  projection->add_content("area");
+  std::shared_ptr<XML::Projection const> const projections[] = {nullptr,
+                                                                projection};
+  for (auto const path :
+       {"../../data/data.xml", "../../data/operations.xml"}) {
+    for (auto const &proj : projections) {
+      std::ifstream istrm(path, std::ios::in);
+      REQUIRE(istrm.is_open());
+      auto const expected = XML::Lexer(istrm, nullptr, proj).tokenize();
+      XML::MappedFile const file(path);
+      auto const data = file.view();
+      // names, attributes and contents are split across the chunks
+      std::size_t const chunk_sizes[] = {1, 2, 3, 7, 64, 4096};
+      for (auto const chunk_size : chunk_sizes) {
+        XML::PushLexer lexer(nullptr, proj);
+        std::vector<XML::Token> tokens;
+        for (std::size_t pos = 0; pos < data.size(); pos += chunk_size) {
+          lexer.feed(data.substr(pos, chunk_size));
+          for (auto &token : lexer.tokenize())
+            tokens.push_back(std::move(token));
+          // only the partial token is buffered
+          REQUIRE(lexer.m_buffer.size() - lexer.m_pos <= 64);
+        }
+        lexer.finish();
+        for (auto &token : lexer.tokenize())
+          tokens.push_back(std::move(token));
+        require_same_tokens(expected, tokens);
+      }
+    }
+  }
+
+  // a partial token is completed at the end of the input
+  XML::PushLexer lexer;
+  lexer.feed("<a x=\"1\">12</a");
+  auto tokens = lexer.tokenize();
+  REQUIRE(tokens.size() == 4);
+  REQUIRE(std::get<XML::Content>(tokens[3]).content == "12");
+  lexer.finish();
+  tokens = lexer.tokenize();
+  REQUIRE(tokens.size() == 1);
+  REQUIRE(std::get<XML::EndTag>(tokens[0]).name == "a");
+  REQUIRE_THROWS_AS(lexer.feed("<b/>"), std::runtime_error);
+}
+
+TEST_CASE("content whitespace") {
+  // like the stream lexer all lexers skip the whitespace of contents
+  std::string const data =
+      "<data><city>New York \n</city><area>1 2\t3</area></data>";
+  std::istringstream istrm(data);
+  auto const expected = XML::Lexer(istrm).tokenize();
+  REQUIRE(std::get<XML::Content>(expected[4]).content == "NewYork");
+  REQUIRE(std::get<XML::Content>(expected[8]).content == "123");
+  XML::StringLexer string_lexer(data);
+  require_same_tokens(expected, string_lexer.tokenize());
+  std::size_t const chunk_sizes[] = {1, 5, 64};
+  for (auto const chunk_size : chunk_sizes) {
+    XML::PushLexer lexer;
+    std::vector<XML::Token> tokens;
+    for (std::size_t pos = 0; pos < data.size(); pos += chunk_size) {
+      lexer.feed(std::string_view(data).substr(pos, chunk_size));
+      for (auto &token : lexer.tokenize())
+        tokens.push_back(std::move(token));
+    }
+    lexer.finish();
+    for (auto &token : lexer.tokenize())
+      tokens.push_back(std::move(token));
+    require_same_tokens(expected, tokens);
+  }
+  XML::LazyDocument const doc(data);
+  REQUIRE(doc[0].content() == "NewYork");
+  REQUIRE(doc[1].content() == "123");
+  REQUIRE(doc[1].content().data() == doc[1].content().data());
+
+  // a content at the end of the input ends there
+  std::istringstream unterminated("<a>1 2");
+  auto const tokens = XML::Lexer(unterminated).tokenize();
+  REQUIRE(std::get<XML::Content>(tokens.back()).content == "12");
+}
+
+TEST_CASE("structural index") {
+  // all byte values, followed by a tail that is not a full block
+  std::string buffer;
+  for (int i = 0; i < 256; ++i)
+    buffer.push_back(static_cast<char>(i));
+  buffer += "<data><city name=\"M\xc3\xbcnchen\"/></data>";
+  std::vector<XML::detail::block_kernel> kernels = {
+      &XML::detail::block_masks_scalar};
+#ifdef YAXP_X86_SIMD
+  kernels.push_back(&XML::detail::block_masks_sse2);
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back(&XML::detail::block_masks_avx2);
+#endif
+  XML::StructuralIndex reference(buffer, &XML::detail::block_masks_scalar);
+  for (auto const kernel : kernels) {
+    XML::StructuralIndex index(buffer, kernel);
+    for (auto const cls :
+         {&XML::BlockMasks::lt, &XML::BlockMasks::eq, &XML::BlockMasks::quote,
+          &XML::BlockMasks::non_alpha, &XML::BlockMasks::token}) {
+      for (std::size_t pos = 0; pos <= buffer.size(); ++pos)
+        REQUIRE(index.find(pos, cls) == reference.find(pos, cls));
+    }
+  }
+  REQUIRE(reference.find(0, &XML::BlockMasks::lt) == '<');
+  REQUIRE(reference.find(0, &XML::BlockMasks::non_alpha) == 0);
+  REQUIRE(reference.find('A', &XML::BlockMasks::non_alpha) == 'Z' + 1);
+}
@@ -1,10 +1,24 @@
 #include <doctest/doctest.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <fstream>
 #include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
 
+#include "accumulator.hpp"
+#include "columns.hpp"
 #include "eval.hpp"
+#include "groups.hpp"
+#include "incremental.hpp"
+#include "mapped_file.hpp"
+#include "number.hpp"
 #include "operation.hpp"
+#include "parallel_parser.hpp"
 #include "parser.hpp"
+#include "path.hpp"
+#include "reduction.hpp"
+#include "result_cache.hpp"
 
 TEST_CASE("operations") {
   std::ifstream stream("../../data/operations.xml", std::ios::in);
@@ -45,4 +59,827 @@ TEST_CASE("operations") {
     REQUIRE(op.m_attrib == "population");
     REQUIRE(op.m_filter == ".*e.*n.*");
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("eval") {
+  std::ifstream data_stream("../../data/data.xml", std::ios::in);
+  std::ifstream op_stream("../../data/operations.xml", std::ios::in);
+  REQUIRE(data_stream.is_open());
+  REQUIRE(op_stream.is_open());
+  auto const data_doc = XML::Parser(XML::Lexer(data_stream).tokenize()).parse();
+  auto const op_doc = XML::Parser(XML::Lexer(op_stream).tokenize()).parse();
+  std::ostringstream expected;
+  Operation::eval(data_doc, op_doc, expected);
+
+  // the streamed evaluation gives the same results as the one on the DOM
+  data_stream.clear();
+  data_stream.seekg(0);
+  op_stream.clear();
+  op_stream.seekg(0);
+  std::ostringstream streamed;
+  Operation::eval(data_stream, op_stream, streamed);
+  REQUIRE(streamed.str() == expected.str());
+
+  // the lazily decoded document gives the same results
+  data_stream.clear();
+  data_stream.seekg(0);
+  std::string const buffer((std::istreambuf_iterator<char>(data_stream)),
+                           std::istreambuf_iterator<char>());
+  std::ostringstream lazy;
+  Operation::eval(XML::LazyDocument(buffer),
+                  Operation::collect_operations(op_doc), lazy);
+  REQUIRE(lazy.str() == expected.str());
+
+  // the binary document gives the same results
+  std::ostringstream binary;
+  XML::write_binary(data_doc, binary);
+  auto const bytes = binary.str();
+  std::vector<std::uint64_t> aligned(bytes.size() / 8 + 1);
+  std::memcpy(aligned.data(), bytes.data(), bytes.size());
+  std::ostringstream cached;
+  Operation::eval(XML::BinaryDocument({reinterpret_cast<char const *>(
+                                           aligned.data()),
+                                       bytes.size()}),
+                  Operation::collect_operations(op_doc), cached);
+  REQUIRE(cached.str() == expected.str());
+
+  // the data received in chunks gives the same results
+  std::size_t const chunk_sizes[] = {1, 5, 1024};
+  for (auto const chunk_size : chunk_sizes) {
+    Operation::PushEvaluator evaluator(Operation::collect_operations(op_doc));
+    for (std::size_t pos = 0; pos < buffer.size(); pos += chunk_size)
+      evaluator.feed(std::string_view(buffer).substr(pos, chunk_size));
+    std::ostringstream pushed;
+    evaluator.finish(pushed);
+    REQUIRE(pushed.str() == expected.str());
+  }
+  REQUIRE(expected.str().find("4030418.67") != std::string::npos);
+  REQUIRE(expected.str().find("3440441.00") != std::string::npos);
+}
+
+TEST_CASE("columns") {
+  XML::MappedFile const data_file("../../data/data.xml");
+  XML::MappedFile const op_file("../../data/operations.xml");
+  auto const data_doc =
+      XML::StringParser(XML::StringLexer(data_file.view()).tokenize()).parse();
+  auto const operations = Operation::collect_operations(
+      XML::StringParser(XML::StringLexer(op_file.view()).tokenize()).parse());
+  Operation::Columns const columns(data_doc, operations);
+
+  // the areas and cities alternate, the root is the last row
+  REQUIRE(columns.size() == 17);
+  REQUIRE(columns.key(0).empty());
+  REQUIRE(columns.key(1) == "Stuttgart");
+  REQUIRE(columns.key(16).empty());
+  // the areas and the root share the empty key
+  REQUIRE(columns.distinct_keys() == 8 + 1);
+  // operations reading the same field share its column
+  REQUIRE(columns.columns() == 2);
+  auto const population = columns.column_index(0);
+  auto const area = columns.column_index(1);
+  REQUIRE(columns.column_index(3) == population);
+  REQUIRE(columns.column_index(2) == area);
+  REQUIRE(columns.values(population)[1] == 601646);
+  REQUIRE(std::isnan(columns.values(population)[0]));
+  REQUIRE(columns.values(area)[1] == doctest::Approx(207.36));
+  REQUIRE(std::isnan(columns.values(area)[0]));
+
+  auto const selected = columns.select(XML::Filter("M.*"));
+  REQUIRE(selected == std::vector<std::size_t>{3, 7, 13});
+  auto const state =
+      Operation::aggregate(columns.values(population), selected,
+                           Operation::Function::max);
+  REQUIRE(state.count == 3);
+  REQUIRE(state.max == 10563038);
+
+  // only the selected rows have to hold values
+  columns.require_values(population, selected);
+  columns.require_values(area, selected);
+  auto const all = columns.select(XML::Filter(".*"));
+  REQUIRE_THROWS_AS(columns.require_values(population, all),
+                    std::invalid_argument);
+  REQUIRE_THROWS_AS(columns.require_values(area, all), std::runtime_error);
+  auto unselective = operations;
+  unselective[1].m_filter = ".*";
+  unselective[1].m_compiled_filter = XML::Filter(".*");
+  std::ostringstream output;
+  REQUIRE_THROWS_AS(Operation::eval(data_doc, unselective, output),
+                    std::runtime_error);
+}
+
+TEST_CASE("parallel eval") {
+  std::ifstream data_stream("../../data/data.xml", std::ios::in);
+  std::ifstream op_stream("../../data/operations.xml", std::ios::in);
+  REQUIRE(data_stream.is_open());
+  REQUIRE(op_stream.is_open());
+  auto const data_doc = XML::Parser(XML::Lexer(data_stream).tokenize()).parse();
+  auto const operations = Operation::collect_operations(
+      XML::Parser(XML::Lexer(op_stream).tokenize()).parse());
+  std::ostringstream expected;
+  Operation::eval(data_doc, operations, expected);
+
+  std::size_t const thread_counts[] = {1, 2, 4};
+  for (auto const threads : thread_counts) {
+    XML::ThreadPool pool(threads);
+    std::size_t const range_sizes[] = {1, 5, 4096};
+    for (auto const range_size : range_sizes) {
+      std::ostringstream parallel;
+      Operation::eval(data_doc, operations, pool, parallel, range_size);
+      REQUIRE(parallel.str() == expected.str());
+    }
+  }
+
+  // parsing only the fields the operations read gives the same results
+  data_stream.clear();
+  data_stream.seekg(0);
+  std::string const buffer((std::istreambuf_iterator<char>(data_stream)),
+                           std::istreambuf_iterator<char>());
+  XML::ThreadPool projected_pool(2);
+  auto const projected_doc =
+      XML::parse_parallel(buffer, projected_pool, 100,
+                          Operation::make_projection(operations));
+  std::ostringstream projected;
+  Operation::eval(projected_doc, operations, projected_pool, projected);
+  REQUIRE(projected.str() == expected.str());
+
+  // errors of a task are rethrown
+  auto broken = operations;
+  broken.back().m_attrib = "nothing";
+  broken.back().m_type = "sub";
+  XML::ThreadPool pool(2);
+  std::ostringstream output;
+  REQUIRE_THROWS(Operation::eval(data_doc, broken, pool, output, 1));
+}
+
+TEST_CASE("group by") {
+  std::string const data =
+      "<data>\n"
+      "<city name=\"Stuttgart\" country=\"Germany\" population=\"601646\">"
+      "<area>207.36</area></city>\n"
+      "<city name=\"Wien\" country=\"Austria\" population=\"1897000\">"
+      "<area>414.6</area></city>\n"
+      "<city name=\"Hamburg\" country=\"Germany\" population=\"1841000\">"
+      "<area>755.2</area></city>\n"
+      "<city name=\"Graz\" country=\"Austria\" population=\"291000\">"
+      "<area>127.6</area></city>\n"
+      "<city name=\"Zurich\" country=\"Switzerland\" population=\"421000\">"
+      "<area>87.9</area></city>\n"
+      "</data>\n";
+  std::string const ops =
+      "<operations>\n"
+      "<operation name=\"area\" type=\"sub\" func=\"average\" "
+      "attrib=\"area\" filter=\"[A-Z].*\" group=\"country\"/>\n"
+      "<operation name=\"total\" type=\"attrib\" func=\"sum\" "
+      "attrib=\"population\" filter=\"[GH].*\"/>\n"
+      "<operation name=\"count\" type=\"attrib\" func=\"count\" "
+      "attrib=\"population\" filter=\"[GH].*\" group=\"country\"/>\n"
+      "</operations>\n";
+  auto const parse_operations = [](std::string const &str) {
+    return Operation::collect_operations(
+        XML::StringParser(XML::StringLexer(str).tokenize()).parse());
+  };
+  auto const operations = parse_operations(ops);
+  REQUIRE(operations[0].m_group == "country");
+  REQUIRE(operations[0].m_group_limit ==
+          Operation::Operation::default_group_limit);
+  REQUIRE(operations[1].m_group.empty());
+  auto const data_doc =
+      XML::StringParser(XML::StringLexer(data).tokenize()).parse();
+
+  // one result per group, in the order the groups first occur
+  std::ostringstream expected;
+  Operation::eval(data_doc, operations, expected);
+  REQUIRE(expected.str() == "<results>\n"
+                            "  <result name=\"area\" group=\"Germany\">\n"
+                            "    481.28\n"
+                            "  </result>\n"
+                            "  <result name=\"area\" group=\"Austria\">\n"
+                            "    271.10\n"
+                            "  </result>\n"
+                            "  <result name=\"area\" group=\"Switzerland\">\n"
+                            "    87.90\n"
+                            "  </result>\n"
+                            "  <result name=\"total\">\n"
+                            "    2132000.00\n"
+                            "  </result>\n"
+                            "  <result name=\"count\" group=\"Germany\">\n"
+                            "    1.00\n"
+                            "  </result>\n"
+                            "  <result name=\"count\" group=\"Austria\">\n"
+                            "    1.00\n"
+                            "  </result>\n"
+                            "</results>");
+
+  // every evaluation strategy gives the same groups
+  std::ostringstream streamed;
+  Operation::eval(std::string_view(data), ops, streamed);
+  REQUIRE(streamed.str() == expected.str());
+  std::ostringstream lazy;
+  Operation::eval(XML::LazyDocument(data), operations, lazy);
+  REQUIRE(lazy.str() == expected.str());
+  std::size_t const range_sizes[] = {1, 2, 4096};
+  for (auto const range_size : range_sizes) {
+    XML::ThreadPool pool(2);
+    std::ostringstream parallel;
+    Operation::eval(data_doc, operations, pool, parallel, range_size);
+    REQUIRE(parallel.str() == expected.str());
+  }
+  Operation::PushEvaluator evaluator(operations);
+  for (std::size_t pos = 0; pos < data.size(); pos += 3)
+    evaluator.feed(std::string_view(data).substr(pos, 3));
+  std::ostringstream pushed;
+  evaluator.finish(pushed);
+  REQUIRE(pushed.str() == expected.str());
+
+  // grouped operations are evaluated in full by the incremental evaluation
+  std::ostringstream first;
+  auto const state =
+      Operation::eval_incremental(data, operations, "data", {}, first);
+  REQUIRE(first.str() == expected.str());
+  REQUIRE(state.offset == 0);
+
+  // the group is part of the key of the result cache
+  auto ungrouped = operations[0];
+  ungrouped.m_group.clear();
+  REQUIRE(Operation::ResultCache::key("data", ungrouped) !=
+          Operation::ResultCache::key("data", operations[0]));
+
+  // exceeding the limit of the groups is an error
+  auto limited = operations;
+  limited[0].m_group_limit = 2;
+  std::ostringstream output;
+  REQUIRE_THROWS_AS(Operation::eval(data_doc, limited, output),
+                    std::runtime_error);
+  XML::ThreadPool pool(2);
+  REQUIRE_THROWS_AS(Operation::eval(data_doc, limited, pool, output, 1),
+                    std::runtime_error);
+  Operation::Groups groups(Operation::Function::sum, 2);
+  groups["a"].add(1.0);
+  groups["b"].add(2.0);
+  groups["a"].add(3.0);
+  REQUIRE(groups.size() == 2);
+  REQUIRE(groups.state(0).sum == 4.0);
+  REQUIRE_THROWS_AS(groups["c"], std::runtime_error);
+  auto const copy = groups;
+  REQUIRE(copy.key(1) == "b");
+  Operation::Groups merged(Operation::Function::sum, 2);
+  merged.merge(copy);
+  merged["a"].add(1.0);
+  REQUIRE(merged.state(0).sum == 5.0);
+
+  auto const limit_of = [&parse_operations](std::string const &limit) {
+    return parse_operations(
+               "<operations><operation name=\"a\" type=\"attrib\" "
+               "func=\"sum\" attrib=\"a\" filter=\".*\" group=\"g\" "
+               "limit=\"" +
+               limit + "\"/></operations>")
+        .front()
+        .m_group_limit;
+  };
+  REQUIRE(limit_of("10") == 10);
+  REQUIRE_THROWS_AS(limit_of("-1"), std::runtime_error);
+}
+
+TEST_CASE("paths") {
+  // invalid expressions are rejected when the operation is read
+  for (auto const expression :
+       {"", "/", "city/", "city//", "city[@x", "city[x]", "city[@x='y]",
+        "city/@a/b", "//@x", "/@x", "city/@"})
+    REQUIRE_THROWS_AS(Operation::Path{expression}, std::runtime_error);
+  Operation::Path const path("//city[@country='DE'][@name]/district/@area");
+  REQUIRE(path.absolute());
+  REQUIRE(path.attribute() == "area");
+  REQUIRE(path.steps().size() == 2);
+  REQUIRE(path.steps()[0].descendant);
+  REQUIRE(path.steps()[0].name == "city");
+  REQUIRE(path.steps()[0].predicates.size() == 2);
+  REQUIRE(*path.steps()[0].predicates[0].value == "DE");
+  REQUIRE_FALSE(path.steps()[0].predicates[1].value);
+  REQUIRE_FALSE(path.steps()[1].descendant);
+
+  std::string const data =
+      "<data>\n"
+      "  <city name=\"Stuttgart\" country=\"DE\" population=\"601646\">\n"
+      "    <district name=\"Mitte\"><area>3.8</area></district>\n"
+      "    <district name=\"Nord\"><area>23.4</area></district>\n"
+      "    <area>207.36</area>\n"
+      "  </city>\n"
+      "  <city name=\"Wien\" country=\"AT\" population=\"1897000\">\n"
+      "    <district><area>2.9</area></district>\n"
+      "    <area>414.6</area>\n"
+      "  </city>\n"
+      "  <city name=\"Hamburg\" country=\"DE\" population=\"1841000\">\n"
+      "    <area>755.2</area>\n"
+      "  </city>\n"
+      "  <region name=\"Alps\">\n"
+      "    <city name=\"Innsbruck\" country=\"AT\" population=\"131000\">\n"
+      "      <area>104.9</area>\n"
+      "    </city>\n"
+      "  </region>\n"
+      "</data>\n";
+  std::string ops = "<operations>\n";
+  auto const add = [&ops](std::string const &name, std::string const &func,
+                          std::string const &path_expr,
+                          std::string const &extra = "filter=\".*\"") {
+    ops += "<operation name=\"" + name + "\" type=\"path\" func=\"" + func +
+           "\" attrib=\"" + path_expr + "\" " + extra + "/>\n";
+  };
+  add("nested", "sum", "city/district/area");
+  add("anywhere", "count", "//area");
+  add("german", "sum", "city[@country='DE']/@population");
+  add("austrian", "sum", "//city[@country='AT']/@population");
+  add("children", "count", "city/@population");
+  add("absolute", "max", "/data/*/area");
+  add("descendants", "count", "city//area");
+  add("named", "average", "//district[@name]/area");
+  add("filtered", "sum", "//city/@population", "filter=\"[SH].*\"");
+  add("grouped", "sum", "//city/@population",
+      "filter=\".*\" group=\"country\"");
+  ops += "<operation name=\"direct\" type=\"attrib\" func=\"sum\" "
+         "attrib=\"population\" filter=\"Wien\"/>\n</operations>\n";
+  auto const operations = Operation::collect_operations(
+      XML::StringParser(XML::StringLexer(ops).tokenize()).parse());
+  auto const data_doc =
+      XML::StringParser(XML::StringLexer(data).tokenize()).parse();
+
+  std::ostringstream expected;
+  Operation::eval(data_doc, operations, expected);
+  auto const result = [&expected](std::string const &name,
+                                  std::string const &group = {}) {
+    auto const tag = "<result name=\"" + name + "\"" +
+                     (group.empty() ? "" : " group=\"" + group + "\"") + ">";
+    auto const pos = expected.str().find(tag);
+    REQUIRE(pos != std::string::npos);
+    return std::stod(expected.str().substr(pos + tag.size()));
+  };
+  REQUIRE(result("nested") == doctest::Approx(30.1));
+  REQUIRE(result("anywhere") == 7);
+  REQUIRE(result("german") == 2442646);
+  REQUIRE(result("austrian") == 2028000);
+  REQUIRE(result("children") == 3);
+  REQUIRE(result("absolute") == doctest::Approx(755.2));
+  REQUIRE(result("descendants") == 6);
+  REQUIRE(result("named") == doctest::Approx(13.6));
+  REQUIRE(result("filtered") == 2442646);
+  REQUIRE(result("grouped", "DE") == 2442646);
+  REQUIRE(result("grouped", "AT") == 2028000);
+  REQUIRE(result("direct") == 1897000);
+
+  // the paths are matched while the data is streamed
+  std::ostringstream streamed;
+  Operation::eval(std::string_view(data), ops, streamed);
+  REQUIRE(streamed.str() == expected.str());
+  std::istringstream data_stream(data);
+  std::istringstream op_stream(ops);
+  std::ostringstream lexed;
+  Operation::eval(data_stream, op_stream, lexed);
+  REQUIRE(lexed.str() == expected.str());
+  Operation::PushEvaluator evaluator(operations);
+  for (std::size_t pos = 0; pos < data.size(); pos += 3)
+    evaluator.feed(std::string_view(data).substr(pos, 3));
+  std::ostringstream pushed;
+  evaluator.finish(pushed);
+  REQUIRE(pushed.str() == expected.str());
+  std::size_t const range_sizes[] = {1, 4096};
+  for (auto const range_size : range_sizes) {
+    XML::ThreadPool pool(2);
+    std::ostringstream parallel;
+    Operation::eval(data_doc, operations, pool, parallel, range_size);
+    REQUIRE(parallel.str() == expected.str());
+  }
+  std::ostringstream lazy;
+  REQUIRE_THROWS_AS(
+      Operation::eval(XML::LazyDocument(data), operations, lazy),
+      std::runtime_error);
+
+  // the matching resumes inside the root
+  std::vector<Operation::Operation> ungrouped;
+  for (auto const &op : operations) {
+    if (op.m_group.empty())
+      ungrouped.push_back(op);
+  }
+  std::ostringstream ungrouped_expected;
+  Operation::eval(data_doc, ungrouped, ungrouped_expected);
+  auto const prefix = data.substr(0, data.find("  <region")) + "</data>\n";
+  std::ostringstream ignored;
+  auto const state =
+      Operation::eval_incremental(prefix, ungrouped, "data", {}, ignored);
+  REQUIRE(state.offset != 0);
+  std::ostringstream resumed;
+  Operation::eval_incremental(data, ungrouped, "data", state, resumed);
+  REQUIRE(resumed.str() == ungrouped_expected.str());
+
+  // only the fields the paths read are lexed, all contents for "*"
+  auto const projection = Operation::make_projection(operations);
+  REQUIRE(projection->keeps_attribute("country"));
+  REQUIRE(projection->keeps_attribute("population"));
+  REQUIRE(projection->keeps_content("area"));
+  REQUIRE_FALSE(projection->keeps_content("district"));
+  auto any = operations;
+  any.front().m_compiled_path = Operation::Path("//*");
+  REQUIRE(Operation::make_projection(any) == nullptr);
+}
+
+TEST_CASE("result cache") {
+  std::ifstream op_stream("../../data/operations.xml", std::ios::in);
+  REQUIRE(op_stream.is_open());
+  auto const operations = Operation::collect_operations(
+      XML::Parser(XML::Lexer(op_stream).tokenize()).parse());
+  REQUIRE(operations.size() >= 3);
+  using Operation::ResultCache;
+
+  // every field of the operation and the data are part of the key
+  auto const key = ResultCache::key("data", operations[0]);
+  REQUIRE(key == ResultCache::key("data", operations[0]));
+  REQUIRE(key != ResultCache::key("other", operations[0]));
+  auto changed = operations[0];
+  changed.m_filter += "x";
+  REQUIRE(key != ResultCache::key("data", changed));
+  changed = operations[0];
+  changed.m_func += "x";
+  REQUIRE(key != ResultCache::key("data", changed));
+
+  // the states are saved exactly
+  Operation::Accumulator state;
+  for (auto const value : {0.1, 0.2, -3.7e200})
+    state.add(value);
+  ResultCache cache(2);
+  std::istringstream empty;
+  cache.load(empty);
+  cache.insert(key, state);
+  cache.insert(ResultCache::key("data", operations[1]), {});
+  std::stringstream saved;
+  cache.save(saved);
+  ResultCache loaded(2);
+  loaded.load(saved);
+  REQUIRE(loaded.size() == 2);
+  auto const found = loaded.find(key);
+  REQUIRE(found);
+  REQUIRE(found->count == state.count);
+  REQUIRE(found->sum == state.sum);
+  REQUIRE(found->min == state.min);
+  REQUIRE(found->max == state.max);
+  REQUIRE(loaded.find(ResultCache::key("data", operations[1]))->count == 0);
+  REQUIRE_FALSE(loaded.find(ResultCache::key("other", operations[0])));
+
+  // the least recently used entries are dropped beyond the capacity
+  saved.str({});
+  saved.clear();
+  loaded.save(saved);
+  ResultCache next(2);
+  next.load(saved);
+  REQUIRE(next.find(key));
+  next.insert(ResultCache::key("data", operations[2]), state);
+  saved.str({});
+  saved.clear();
+  next.save(saved);
+  ResultCache last(2);
+  last.load(saved);
+  REQUIRE(last.size() == 2);
+  REQUIRE(last.find(key));
+  REQUIRE(last.find(ResultCache::key("data", operations[2])));
+  REQUIRE_FALSE(last.find(ResultCache::key("data", operations[1])));
+}
+
+TEST_CASE("incremental") {
+  std::ifstream data_stream("../../data/data.xml", std::ios::in);
+  std::ifstream op_stream("../../data/operations.xml", std::ios::in);
+  REQUIRE(data_stream.is_open());
+  REQUIRE(op_stream.is_open());
+  std::string const data((std::istreambuf_iterator<char>(data_stream)),
+                         std::istreambuf_iterator<char>());
+  std::string const ops((std::istreambuf_iterator<char>(op_stream)),
+                        std::istreambuf_iterator<char>());
+  auto const operations = Operation::collect_operations(
+      XML::StringParser(XML::StringLexer(ops).tokenize()).parse());
+  auto const expect = [&ops](std::string const &doc) {
+    std::ostringstream output;
+    Operation::eval(std::string_view(doc), ops, output);
+    return output.str();
+  };
+
+  std::ostringstream first;
+  auto const state = Operation::eval_incremental(data, operations, "data",
+                                                 {}, first);
+  REQUIRE(first.str() == expect(data));
+  REQUIRE(state.offset == data.rfind("</city>") + 7);
+  REQUIRE(state.keys.size() == operations.size());
+
+  // the saved state is read back exactly
+  std::stringstream saved;
+  state.save(saved);
+  Operation::IncrementalState loaded;
+  loaded.load(saved);
+  REQUIRE(loaded.offset == state.offset);
+  REQUIRE(loaded.checksum == state.checksum);
+  REQUIRE(loaded.keys == state.keys);
+  REQUIRE(loaded.accumulators.size() == state.accumulators.size());
+  REQUIRE(loaded.accumulators.back().sum == state.accumulators.back().sum);
+
+  // append cities in front of the end tag of the root
+  auto const end = data.rfind("</data>");
+  auto const first_city = data.find("<city");
+  auto const second_city = data.find("<city", first_city + 1);
+  auto const grown =
+      data.substr(0, end) + data.substr(first_city, second_city - first_city) +
+      "<city name=\"Bonn\" population=\"300000\"><area>141.1</area></city>\n"
+      "</data>\n";
+  std::ostringstream second;
+  auto const grown_state = Operation::eval_incremental(
+      grown, operations, "data", loaded, second);
+  REQUIRE(second.str() == expect(grown));
+  REQUIRE(grown_state.offset > state.offset);
+
+  // only the data behind the offset is evaluated
+  auto tampered = state;
+  for (auto &acc : tampered.accumulators)
+    acc.add(1e9);
+  std::ostringstream resumed;
+  Operation::eval_incremental(grown, operations, "data", tampered, resumed);
+  REQUIRE(resumed.str() != expect(grown));
+
+  // changed data or operations are evaluated in full
+  auto changed = grown;
+  changed.replace(0, 6, "<root>");
+  std::ostringstream other;
+  Operation::eval_incremental(changed, operations, "data", tampered, other);
+  REQUIRE(other.str() == expect(changed));
+  std::ostringstream other_ops;
+  Operation::eval_incremental(grown, operations, "other", tampered, other_ops);
+  REQUIRE(other_ops.str() == expect(grown));
+}
+
+TEST_CASE("thread pool") {
+  XML::ThreadPool pool(3);
+  REQUIRE(pool.size() == 3);
+  // tasks submitted by a worker are run by the pool as well
+  auto nested = pool.submit([&pool]() {
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i)
+      futures.push_back(pool.submit([i]() { return i; }));
+    return futures;
+  });
+  int sum = 0;
+  for (auto &future : nested.get())
+    sum += future.get();
+  REQUIRE(sum == 4950);
+}
+
+TEST_CASE("accumulator") {
+  std::vector<double> const values = {3.5, -1.25, 10.0, 0.1, 0.2, 7.0};
+  Operation::Accumulator acc;
+  Operation::Accumulator first;
+  Operation::Accumulator second;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    acc.add(values[i]);
+    (i < 3 ? first : second).add(values[i]);
+  }
+  for (auto const func : {"min", "max", "sum", "average"})
+    REQUIRE(acc.result(func) ==
+            doctest::Approx(Operation::apply_func(func, values)));
+  REQUIRE(acc.result(Operation::Function::min) == -1.25);
+  REQUIRE(acc.result(Operation::Function::max) == 10.0);
+  first.merge(second);
+  REQUIRE(first.count == values.size());
+  REQUIRE(first.min == -1.25);
+  REQUIRE(first.max == 10.0);
+  REQUIRE(first.result("sum") == doctest::Approx(acc.result("sum")));
+  REQUIRE_THROWS(acc.result("median"));
+  REQUIRE(Operation::apply_func("median", {1.0, 2.0, 3.0, 4.0}) == 2.5);
+  REQUIRE(Operation::apply_func("variance", {1.0, 3.0}) == 1.0);
+  REQUIRE(Operation::apply_func("distinct", {1.0, 2.0, 1.0}) == 2.0);
+  REQUIRE(Operation::parse_function("average") ==
+          Operation::Function::average);
+  REQUIRE_THROWS_AS(Operation::parse_function("mode"), std::runtime_error);
+}
+
+TEST_CASE("sketches") {
+  std::vector<double> values;
+  for (std::size_t i = 0; i < 100000; ++i)
+    values.push_back(static_cast<double>((i * 7919) % 100000));
+
+  // the moments merged in any order give the variance of all values
+  Operation::Moments all, first, second;
+  double mean = 0.0;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    all.add(values[i]);
+    (i % 3 == 0 ? first : second).add(values[i]);
+    mean += values[i];
+  }
+  mean /= static_cast<double>(values.size());
+  double variance = 0.0;
+  for (auto const value : values)
+    variance += (value - mean) * (value - mean);
+  variance /= static_cast<double>(values.size());
+  first.merge(second);
+  REQUIRE(all.variance() == doctest::Approx(variance));
+  REQUIRE(first.variance() == doctest::Approx(variance));
+  Operation::Moments decoded;
+  REQUIRE(decoded.decode(all.encode()));
+  REQUIRE(decoded.count == all.count);
+  REQUIRE(decoded.m2 == all.m2);
+
+  // small sets give the exact quantiles
+  Operation::QuantileSketch small;
+  for (auto const value : {5.0, 1.0, 4.0, 2.0})
+    small.add(value);
+  REQUIRE(small.quantile(0.5) == 3.0);
+  REQUIRE(small.quantile(0.0) == 1.0);
+  REQUIRE(small.quantile(1.0) == 5.0);
+  REQUIRE(std::isnan(Operation::QuantileSketch().quantile(0.5)));
+
+  // large sets, also merged from parts, give close estimates
+  Operation::QuantileSketch digest, lower, upper;
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    digest.add(values[i]);
+    (values[i] < 50000 ? lower : upper).add(values[i]);
+  }
+  lower.merge(upper);
+  for (auto const q : {0.5, 0.95, 0.99}) {
+    REQUIRE(digest.quantile(q) == doctest::Approx(q * 1e5).epsilon(0.01));
+    REQUIRE(lower.quantile(q) == doctest::Approx(q * 1e5).epsilon(0.01));
+  }
+  Operation::QuantileSketch restored;
+  REQUIRE(restored.decode(digest.encode()));
+  REQUIRE(restored.quantile(0.99) == digest.quantile(0.99));
+  REQUIRE_FALSE(restored.decode("1,x"));
+  // the states are read back exactly, fields are neither empty nor padded
+  std::vector<double> numbers;
+  REQUIRE(Operation::detail::parse_numbers("0x1p+0,-0x1.8p+1,inf", numbers));
+  REQUIRE(numbers == std::vector<double>{
+                         1.0, -3.0, std::numeric_limits<double>::infinity()});
+  REQUIRE_FALSE(Operation::detail::parse_numbers("1,2,", numbers));
+  REQUIRE_FALSE(Operation::detail::parse_numbers(" 1,2", numbers));
+  REQUIRE_FALSE(Operation::detail::parse_numbers("1,,2", numbers));
+  std::string encoded;
+  Operation::detail::append_number(encoded, -0.1);
+  REQUIRE(encoded == "-0x1.999999999999ap-4");
+  REQUIRE(Operation::parse_whole_number(encoded) == -0.1);
+
+  // the distinct count is exact for few and close for many values
+  Operation::DistinctCounter few, many, even, odd;
+  for (auto const value : {1.0, 2.0, 2.0, 0.0, -0.0, 3.5})
+    few.add(value);
+  REQUIRE(std::round(few.estimate()) == 4);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    many.add(values[i]);
+    many.add(values[i]);
+    (i % 2 == 0 ? even : odd).add(values[i]);
+  }
+  even.merge(odd);
+  REQUIRE(many.estimate() == doctest::Approx(1e5).epsilon(0.05));
+  REQUIRE(even.estimate() == many.estimate());
+  Operation::DistinctCounter counted;
+  REQUIRE(counted.decode(many.encode()));
+  REQUIRE(counted.estimate() == many.estimate());
+  REQUIRE_FALSE(counted.decode("12"));
+}
+
+TEST_CASE("extended functions") {
+  std::ifstream data_stream("../../data/data.xml", std::ios::in);
+  REQUIRE(data_stream.is_open());
+  std::string const data((std::istreambuf_iterator<char>(data_stream)),
+                         std::istreambuf_iterator<char>());
+  std::string ops = "<operations>\n";
+  for (auto const func : {"count", "variance", "stddev", "median", "p50",
+                          "p95", "p99", "distinct", "sum"})
+    ops += std::string("<operation name=\"") + func +
+           "\" type=\"attrib\" func=\"" + func +
+           "\" attrib=\"population\" filter=\"[A-Z].*\"/>\n";
+  ops += "</operations>\n";
+  auto const operations = Operation::collect_operations(
+      XML::StringParser(XML::StringLexer(ops).tokenize()).parse());
+  auto const data_doc =
+      XML::StringParser(XML::StringLexer(data).tokenize()).parse();
+  std::ostringstream expected;
+  Operation::eval(data_doc, operations, expected);
+
+  // the populations of the eight cities
+  std::vector<double> const cities = {601646,  10563038, 588292, 1330440,
+                                      3440441, 1774224,  197778, 134218};
+  double mean = 0.0;
+  for (auto const value : cities)
+    mean += value;
+  mean /= static_cast<double>(cities.size());
+  double variance = 0.0;
+  for (auto const value : cities)
+    variance += (value - mean) * (value - mean);
+  variance /= static_cast<double>(cities.size());
+  auto const result = [&expected](std::string const &name) {
+    auto const tag = "<result name=\"" + name + "\">";
+    auto const pos = expected.str().find(tag);
+    REQUIRE(pos != std::string::npos);
+    return std::stod(expected.str().substr(pos + tag.size()));
+  };
+  REQUIRE(result("count") == 8);
+  REQUIRE(result("variance") == doctest::Approx(variance));
+  REQUIRE(result("stddev") == doctest::Approx(std::sqrt(variance)));
+  REQUIRE(result("median") == (601646 + 1330440) / 2.0);
+  REQUIRE(result("p50") == (601646 + 1330440) / 2.0);
+  REQUIRE(result("p95") == 10563038);
+  REQUIRE(result("p99") == 10563038);
+  REQUIRE(result("distinct") == 8);
+
+  // every evaluation strategy merges the states to the same results
+  std::ostringstream streamed;
+  Operation::eval(std::string_view(data), ops, streamed);
+  REQUIRE(streamed.str() == expected.str());
+  std::size_t const range_sizes[] = {1, 5};
+  for (auto const range_size : range_sizes) {
+    XML::ThreadPool pool(2);
+    std::ostringstream parallel;
+    Operation::eval(data_doc, operations, pool, parallel, range_size);
+    REQUIRE(parallel.str() == expected.str());
+  }
+  Operation::PushEvaluator evaluator(operations);
+  for (std::size_t pos = 0; pos < data.size(); pos += 7)
+    evaluator.feed(std::string_view(data).substr(pos, 7));
+  std::ostringstream pushed;
+  evaluator.finish(pushed);
+  REQUIRE(pushed.str() == expected.str());
+
+  // the sketches survive saving the incremental state
+  auto const end = data.rfind("<city");
+  auto const prefix = data.substr(0, end) + "</data>\n";
+  std::ostringstream ignored;
+  auto const state =
+      Operation::eval_incremental(prefix, operations, "data", {}, ignored);
+  std::stringstream saved;
+  state.save(saved);
+  Operation::IncrementalState loaded;
+  loaded.load(saved);
+  std::ostringstream resumed;
+  Operation::eval_incremental(data, operations, "data", loaded, resumed);
+  REQUIRE(resumed.str() == expected.str());
+}
+
+TEST_CASE("reduction") {
+  std::vector<Operation::detail::reduce_kernel> kernels = {
+      &Operation::detail::reduce_scalar};
+#ifdef YAXP_X86_SIMD
+  kernels.push_back(&Operation::detail::reduce_sse2);
+  if (__builtin_cpu_supports("avx2"))
+    kernels.push_back(&Operation::detail::reduce_avx2);
+#endif
+  std::vector<double> values;
+  for (std::size_t i = 0; i < 10000; ++i)
+    values.push_back(static_cast<double>((i * 7919) % 1000) / 8.0 - 50.0);
+  for (auto const kernel : kernels) {
+    std::size_t const counts[] = {0, 1, 3, 255, 256, 257, 1000, 10000};
+    for (auto const count : counts) {
+      Operation::Accumulator expected;
+      for (std::size_t i = 0; i < count; ++i)
+        expected.add(values[i]);
+      auto const state = Operation::reduce(values.data(), count, kernel);
+      REQUIRE(state.count == expected.count);
+      // the values are multiples of 1/8, so every order sums exactly
+      REQUIRE(state.sum == expected.sum);
+      REQUIRE(state.min == expected.min);
+      REQUIRE(state.max == expected.max);
+    }
+
+    // NaNs are ignored by min and max like by Accumulator::add
+    std::vector<double> const with_nan = {
+        2.0, std::numeric_limits<double>::quiet_NaN(), -3.0, 7.0, 1.0};
+    auto const state = Operation::reduce(with_nan.data(), with_nan.size(),
+                                         kernel);
+    REQUIRE(state.min == -3.0);
+    REQUIRE(state.max == 7.0);
+    REQUIRE(std::isnan(state.sum));
+
+    // the pairwise sum stays accurate where the sequential one drifts
+    std::vector<double> const tenths(1 << 20, 0.1);
+    Operation::Accumulator sequential;
+    for (auto const value : tenths)
+      sequential.add(value);
+    auto const exact = 0.1 * static_cast<double>(tenths.size());
+    auto const pairwise = Operation::reduce(tenths, kernel).sum;
+    REQUIRE(std::abs(pairwise - exact) < std::abs(sequential.sum - exact));
+    REQUIRE(std::abs(pairwise - exact) < 1e-9);
+  }
+}
+
+TEST_CASE("number") {
+  REQUIRE(Operation::parse_number("207.36") == 207.36);
+  REQUIRE(Operation::parse_number("10563038") == 10563038.0);
+  REQUIRE(Operation::parse_number("-1.5e3") == -1500.0);
+  REQUIRE(Operation::parse_number("  +42") == 42.0);
+  REQUIRE(Operation::parse_number("0x10") == 16.0);
+  REQUIRE(Operation::parse_number("12abc") == 12.0);
+  REQUIRE(not Operation::parse_number(""));
+  REQUIRE(not Operation::parse_number("abc"));
+  REQUIRE(not Operation::parse_number("+-1"));
+  REQUIRE(not Operation::parse_number("1e999"));
+  // the same results as std::stod
+  for (std::string const str :
+       {"0.1", "3323.7", "1e-5", "755.264", "  1.25", "-0", "601646"})
+    REQUIRE(Operation::to_double(str) == std::stod(str));
+  REQUIRE_THROWS_AS(Operation::to_double("abc"), std::invalid_argument);
+  REQUIRE_THROWS_AS(Operation::to_double("1e999"), std::out_of_range);
+  // saved states are read back exactly and only as a whole
+  REQUIRE(Operation::parse_whole_number("0x1.8p+1") == 3.0);
+  REQUIRE(Operation::parse_whole_number("-inf") ==
+          -std::numeric_limits<double>::infinity());
+  REQUIRE(not Operation::parse_whole_number("0x1.8p+"));
+  REQUIRE(not Operation::parse_whole_number("1.5x"));
+}
@@ -1,8 +1,16 @@
 #include <doctest/doctest.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 #include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
 
+#include "binary_document.hpp"
+#include "lazy_document.hpp"
+#include "parallel_parser.hpp"
 #include "parser.hpp"
+#include "writer.hpp"
 
 TEST_CASE("data") {
   std::ifstream stream("../../data/data_small.xml", std::ios::in);
@@ -37,4 +45,330 @@ TEST_CASE("operations") {
   XML::Parser parser(lexer.tokenize());
   auto const doc = parser.parse();
   REQUIRE(doc.size() == 5);
-}
\ No newline at end of file
+}
+TEST_CASE("arena") {
+  XML::XML_Doc filtered;
+  {
+    std::ifstream stream("../../data/data.xml", std::ios::in);
+    REQUIRE(stream.is_open());
+    auto const doc = XML::Parser(XML::Lexer(stream).tokenize()).parse();
+    REQUIRE(doc.m_arena->block_count() == 1);
+    auto const &root = *doc.back();
+    REQUIRE(root.name == "data");
+    REQUIRE(root.parent == nullptr);
+    std::size_t cities = 0;
+    for (auto const city : root.children()) {
+      REQUIRE(city->parent == &root);
+      REQUIRE(city->nesting_level == 1);
+      REQUIRE(city->attributes.size() == 2);
+      REQUIRE(city->attributes[0].key_val.first == "name");
+      REQUIRE(city->get_child("area").parent == city);
+      ++cities;
+    }
+    REQUIRE(cities == 8);
+    REQUIRE(root.first_child->get_attribute("population") == "601646");
+    REQUIRE(root.first_child->get_attribute("area").empty());
+    REQUIRE_THROWS(root.first_child->get_child("name"));
+    filtered = XML::attr_filter(doc, "name", ".*burg");
+  }
+  // the filtered document keeps the elements alive
+  REQUIRE(filtered.size() == 2);
+  REQUIRE(filtered[0]->get_attribute("name") == "Hamburg");
+  REQUIRE(filtered[1]->get_child("area").content == "80.76");
+}
+
+TEST_CASE("symbols") {
+  std::ifstream stream("../../data/data.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  // the lexer interns the names in the table of the document
+  auto const symbols = std::make_shared<XML::SymbolTable>();
+  auto const doc =
+      XML::Parser(XML::Lexer(stream, symbols).tokenize(), symbols).parse();
+  REQUIRE(doc.m_symbols == symbols);
+  REQUIRE(symbols->size() == 5);
+  auto const city = symbols->find("city");
+  auto const name = symbols->find("name");
+  auto const area = symbols->find("area");
+  REQUIRE(symbols->find("nothing") == XML::no_symbol);
+  REQUIRE(symbols->name(city) == "city");
+  REQUIRE(symbols->intern("city") == city);
+
+  auto const &root = *doc.back();
+  REQUIRE(root.symbol == symbols->find("data"));
+  for (auto const elem : root.children()) {
+    REQUIRE(elem->symbol == city);
+    REQUIRE(elem->name.data() == symbols->name(city).data());
+    REQUIRE(elem->get_attribute(name) == elem->get_attribute("name"));
+    REQUIRE(elem->find_child(area) == &elem->get_child("area"));
+    REQUIRE(elem->find_child(name) == nullptr);
+    REQUIRE(elem->get_attribute(area).empty());
+  }
+
+  // without a table of the lexer the parser interns the names
+  stream.clear();
+  stream.seekg(0);
+  auto const interned = XML::Parser(XML::Lexer(stream).tokenize()).parse();
+  REQUIRE(interned.m_symbols->size() == 5);
+  REQUIRE(interned.back()->first_child->get_attribute(
+              interned.m_symbols->find("name")) == "Stuttgart");
+}
+
+namespace {
+void require_same_doc(XML::XML_Doc const &lhs, XML::XML_Doc const &rhs) {
+  REQUIRE(lhs.size() == rhs.size());
+  for (std::size_t i = 0; i < lhs.size(); ++i) {
+    auto const &l = *lhs[i];
+    auto const &r = *rhs[i];
+    REQUIRE(l.name == r.name);
+    REQUIRE(lhs.m_symbols->name(l.symbol) == l.name);
+    REQUIRE(l.content == r.content);
+    REQUIRE(l.nesting_level == r.nesting_level);
+    REQUIRE(l.attributes.size() == r.attributes.size());
+    for (std::size_t a = 0; a < l.attributes.size(); ++a) {
+      REQUIRE(l.attributes[a].key_val == r.attributes[a].key_val);
+      REQUIRE(lhs.m_symbols->name(l.attributes[a].key_symbol) ==
+              l.attributes[a].key_val.first);
+    }
+    REQUIRE((l.parent == nullptr) == (r.parent == nullptr));
+    if (l.parent)
+      REQUIRE(l.parent->name == r.parent->name);
+    std::vector<std::string_view> l_children, r_children;
+    for (auto const child : l.children())
+      l_children.push_back(child->name);
+    for (auto const child : r.children())
+      r_children.push_back(child->name);
+    REQUIRE(l_children == r_children);
+  }
+}
+} // namespace
+
+TEST_CASE("parallel") {
+  std::ifstream stream("../../data/data.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  std::string const buffer((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+  auto const expected =
+      XML::StringParser(XML::StringLexer(buffer).tokenize()).parse();
+  std::size_t const thread_counts[] = {1, 2, 4};
+  for (auto const threads : thread_counts) {
+    XML::ThreadPool pool(threads);
+    std::size_t const chunk_sizes[] = {1, 100, 1 << 20};
+    for (auto const chunk_size : chunk_sizes) {
+      auto const doc = XML::parse_parallel(buffer, pool, chunk_size);
+      require_same_doc(doc, expected);
+      REQUIRE(doc.back()->children().begin() != doc.back()->children().end());
+    }
+  }
+
+  // nested elements with the name of the split are parsed sequentially
+  std::string const nested =
+      "<data><item><item><value>1</value></item></item><item/></data>";
+  XML::ThreadPool pool(2);
+  require_same_doc(
+      XML::parse_parallel(nested, pool, 1),
+      XML::StringParser(XML::StringLexer(nested).tokenize()).parse());
+}
+
+TEST_CASE("lazy") {
+  std::ifstream stream("../../data/data.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  std::string const buffer((std::istreambuf_iterator<char>(stream)),
+                           std::istreambuf_iterator<char>());
+  auto const expected =
+      XML::StringParser(XML::StringLexer(buffer).tokenize()).parse();
+  XML::LazyDocument const doc(buffer);
+  REQUIRE(doc.size() == expected.size());
+  for (std::size_t i = 0; i < doc.size(); ++i) {
+    auto const elem = doc[i];
+    auto const &other = *expected[i];
+    REQUIRE(elem.name() == other.name);
+    REQUIRE(elem.nesting_level() == other.nesting_level);
+    REQUIRE(elem.content() == other.content);
+    REQUIRE(elem.has_parent() == (other.parent != nullptr));
+    if (elem.has_parent())
+      REQUIRE(elem.parent().name() == other.parent->name);
+    auto const attributes = elem.attributes();
+    REQUIRE(attributes.size() == other.attributes.size());
+    for (std::size_t a = 0; a < attributes.size(); ++a) {
+      REQUIRE(attributes[a] == other.attributes[a].key_val);
+      REQUIRE(elem.get_attribute(attributes[a].first) ==
+              other.get_attribute(attributes[a].first));
+    }
+    auto const children = other.children();
+    REQUIRE(std::distance(elem.children().begin(), elem.children().end()) ==
+            std::distance(children.begin(), children.end()));
+  }
+
+  std::string const small =
+      "<?xml version=\"1.0\"?><data><city name=\"a>b\" id=\"1\">Berlin  "
+      "<area>891.7</area></city><city name=\"c\"/></data>";
+  XML::LazyDocument const lazy(small);
+  REQUIRE(lazy.size() == 4);
+  REQUIRE(lazy.back().name() == "data");
+  auto const city = lazy[1];
+  REQUIRE(city.get_attribute("name") == "a>b");
+  REQUIRE(city.get_attribute("id") == "1");
+  REQUIRE(city.get_attribute("other").empty());
+  std::vector<std::string_view> values;
+  city.get_attributes({"other", "id", "name", "id"}, values);
+  REQUIRE(values == std::vector<std::string_view>{"", "1", "a>b", "1"});
+  REQUIRE(city.content() == "Berlin");
+  REQUIRE(city.get_child("area").content() == "891.7");
+  REQUIRE_THROWS(city.get_child("other"));
+  REQUIRE(lazy[2].get_attribute("name") == "c");
+  REQUIRE(lazy[2].children().empty());
+  REQUIRE(XML::name_filter(lazy, XML::Filter("cit.*")).size() == 2);
+  REQUIRE(XML::attr_filter(lazy, "name", XML::Filter("c")).front() == lazy[2]);
+}
+
+namespace {
+/* Copy @p bytes to a buffer aligned like a memory mapping. */
+std::vector<std::uint64_t> aligned_copy(std::string const &bytes) {
+  std::vector<std::uint64_t> buffer(bytes.size() / 8 + 1);
+  std::memcpy(buffer.data(), bytes.data(), bytes.size());
+  return buffer;
+}
+} // namespace
+
+TEST_CASE("binary") {
+  std::ifstream stream("../../data/data.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  auto const expected = XML::Parser(XML::Lexer(stream).tokenize()).parse();
+  std::ostringstream output;
+  XML::write_binary(expected, output, 42, 7);
+  auto const bytes = output.str();
+  auto const buffer = aligned_copy(bytes);
+  XML::BinaryDocument const doc(
+      {reinterpret_cast<char const *>(buffer.data()), bytes.size()});
+  REQUIRE(doc.source_size() == 42);
+  REQUIRE(doc.source_time() == 7);
+  REQUIRE(doc.size() == expected.size());
+  REQUIRE(doc.symbols().size() == expected.m_symbols->size());
+  for (std::size_t i = 0; i < doc.size(); ++i) {
+    auto const elem = doc[i];
+    auto const &other = *expected[i];
+    REQUIRE(elem.name() == other.name);
+    REQUIRE(elem.symbol() == other.symbol);
+    REQUIRE(elem.nesting_level() == other.nesting_level);
+    REQUIRE(elem.content() == other.content);
+    REQUIRE(elem.has_parent() == (other.parent != nullptr));
+    if (elem.has_parent())
+      REQUIRE(elem.parent().name() == other.parent->name);
+    auto const attributes = elem.attributes();
+    REQUIRE(attributes.size() == other.attributes.size());
+    for (std::size_t a = 0; a < attributes.size(); ++a) {
+      REQUIRE(attributes[a] == other.attributes[a].key_val);
+      REQUIRE(elem.get_attribute(other.attributes[a].key_symbol) ==
+              other.attributes[a].key_val.second);
+      REQUIRE(elem.get_attribute(attributes[a].first) ==
+              attributes[a].second);
+    }
+    auto const children = other.children();
+    REQUIRE(std::distance(elem.children().begin(), elem.children().end()) ==
+            std::distance(children.begin(), children.end()));
+  }
+  REQUIRE(doc.back().get_attribute("nothing").empty());
+  REQUIRE(doc.back().get_child("city").name() == "city");
+  REQUIRE_THROWS(doc.back().get_child("nothing"));
+
+  // the parents of a filtered document are not stored
+  auto const areas = XML::name_filter(expected, "area");
+  std::ostringstream filtered;
+  XML::write_binary(areas, filtered);
+  auto const filtered_buffer = aligned_copy(filtered.str());
+  XML::BinaryDocument const filtered_doc(
+      {reinterpret_cast<char const *>(filtered_buffer.data()),
+       filtered.str().size()});
+  REQUIRE(filtered_doc.size() == areas.size());
+  REQUIRE_FALSE(filtered_doc[0].has_parent());
+  REQUIRE(filtered_doc[0].content() == areas[0]->content);
+
+  // truncated and foreign buffers are rejected
+  auto const truncated = aligned_copy(bytes.substr(0, bytes.size() / 2));
+  REQUIRE_THROWS_AS(
+      XML::BinaryDocument(
+          {reinterpret_cast<char const *>(truncated.data()), bytes.size() / 2}),
+      std::runtime_error);
+  // links that could form a cycle are rejected when they are read
+  auto corrupt = bytes;
+  XML::binary::Header header;
+  std::memcpy(&header, corrupt.data(), sizeof(header));
+  std::uint32_t const self = 0;
+  auto const parent =
+      header.elements + offsetof(XML::binary::Element, parent);
+  std::memcpy(&corrupt[parent], &self, sizeof(self));
+  auto const corrupt_buffer = aligned_copy(corrupt);
+  XML::BinaryDocument const corrupt_doc(
+      {reinterpret_cast<char const *>(corrupt_buffer.data()), bytes.size()});
+  REQUIRE(corrupt_doc[1].name() == expected[1]->name);
+  REQUIRE_THROWS_AS(corrupt_doc[0].has_parent(), std::runtime_error);
+  std::string const text(bytes.size(), 'x');
+  auto const foreign = aligned_copy(text);
+  REQUIRE_THROWS_AS(
+      XML::BinaryDocument(
+          {reinterpret_cast<char const *>(foreign.data()), text.size()}),
+      std::runtime_error);
+}
+
+TEST_CASE("writer") {
+  std::ifstream stream("../../data/data_small.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  auto const doc = XML::Parser(XML::Lexer(stream).tokenize()).parse();
+  std::string const expected =
+      "<data>\n"
+      "  <city name=\"Stuttgart\" population=\"601646\">\n"
+      "    <area>\n"
+      "        207.36\n"
+      "    </area>\n"
+      "  </city>\n"
+      "  <city name=\"Moskau\" population=\"10563038\">\n"
+      "    <area>\n"
+      "        1081.5\n"
+      "    </area>\n"
+      "  </city>\n"
+      "  <city name=\"M\xc3\xbcnchen\" population=\"1330440\">\n"
+      "    <area>\n"
+      "        310.43\n"
+      "    </area>\n"
+      "  </city>\n"
+      "</data>";
+  // flushing in small blocks gives the same output
+  std::size_t const block_sizes[] = {1, 7, 64 * 1024};
+  for (auto const block_size : block_sizes) {
+    std::ostringstream output;
+    {
+      XML::Writer writer(output, block_size);
+      writer.write(doc);
+    }
+    REQUIRE(output.str() == expected);
+  }
+
+  std::ostringstream numbers;
+  {
+    XML::Writer writer(numbers);
+    writer.start_element("result", 1);
+    writer.attribute("name", "x");
+    writer.end_start_tag();
+    for (auto const value : {4030418.6751, 0.004, -1.0 / 3.0, 1e20})
+      writer.content(value, 2, 1);
+    writer.end_element("result", 1);
+  }
+  REQUIRE(numbers.str() == "  <result name=\"x\">\n"
+                           "    4030418.68\n"
+                           "    0.00\n"
+                           "    -0.33\n"
+                           "    100000000000000000000.00\n"
+                           "  </result>");
+
+  // deeply nested documents do not overflow the stack
+  std::string deep;
+  for (int i = 0; i < 10000; ++i)
+    deep += "<a>";
+  for (int i = 0; i < 10000; ++i)
+    deep += "</a>";
+  auto const deep_doc =
+      XML::StringParser(XML::StringLexer(deep).tokenize()).parse();
+  std::ostringstream deep_output;
+  XML::Writer(deep_output).write(deep_doc);
+  REQUIRE(deep_output.str().size() > 2 * deep.size());
+}
@@ -0,0 +1,61 @@
+#include <doctest/doctest.h>
+#include <fstream>
+#include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
+
+#include "mapped_file.hpp"
+#include "reader.hpp"
+
+TEST_CASE("data") {
+  std::ifstream stream("../../data/data_small.xml", std::ios::in);
+  REQUIRE(stream.is_open());
+  XML::Reader<XML::Lexer> reader(stream);
+  auto event = reader.next();
+  REQUIRE(std::get<XML::StartTagBegin>(*event).name == "data");
+  REQUIRE(reader.depth() == 1);
+  event = reader.next();
+  REQUIRE(std::get<XML::StartTagBegin>(*event).name == "city");
+  REQUIRE(reader.depth() == 2);
+  event = reader.next();
+  REQUIRE(std::get<XML::Attribute>(*event).key_val.second == "Stuttgart");
+  event = reader.next();
+  REQUIRE(std::get<XML::Attribute>(*event).key_val.second == "601646");
+  event = reader.next();
+  REQUIRE(std::get<XML::StartTagBegin>(*event).name == "area");
+  REQUIRE(reader.depth() == 3);
+  REQUIRE(reader.open_elements().front() == "data");
+  event = reader.next();
+  REQUIRE(std::get<XML::Content>(*event).content == "207.36");
+  event = reader.next();
+  REQUIRE(std::get<XML::EndTag>(*event).name == "area");
+  REQUIRE(reader.depth() == 2);
+  event = reader.next();
+  REQUIRE(std::get<XML::EndTag>(*event).name == "city");
+  REQUIRE(reader.depth() == 1);
+}
+
+TEST_CASE("operations") {
+  XML::MappedFile const file("../../data/operations.xml");
+  XML::Reader<XML::StringLexer> reader(file.view());
+  std::size_t starts = 0;
+  std::size_t attributes = 0;
+  std::size_t ends = 0;
+  std::size_t max_depth = 0;
+  XML::for_each_event(reader, [&](auto const &arg) {
+    using T = std::decay_t<decltype(arg)>;
+    if constexpr (std::is_same_v<T, XML::BasicStartTagBegin<std::string_view>>)
+      ++starts;
+    if constexpr (std::is_same_v<T, XML::BasicAttribute<std::string_view>>)
+      ++attributes;
+    if constexpr (std::is_same_v<T, XML::BasicEndTag<std::string_view>>) {
+      // self closing operations are reported with their name
+      REQUIRE(arg.name == (reader.depth() == 0 ? "operations" : "operation"));
+      ++ends;
+    }
+    max_depth = std::max(max_depth, reader.depth());
+  });
+  REQUIRE(starts == 5);
+  REQUIRE(attributes == 20);
+  REQUIRE(ends == 5);
+  REQUIRE(max_depth == 2);
+  REQUIRE(reader.depth() == 0);
+}
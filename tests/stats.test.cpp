@@ -0,0 +1,67 @@
+#include <doctest/doctest.h>
+#include <fstream>
+#include <iostream> // toolchain issues on osx: https://github.com/onqtam/doctest/issues/356
+#include <sstream>
+
+#include "eval.hpp"
+#include "parallel_parser.hpp"
+#include "stats.hpp"
+
+TEST_CASE("stats") {
+  std::ifstream data_stream("../../data/data.xml", std::ios::in);
+  std::ifstream op_stream("../../data/operations.xml", std::ios::in);
+  REQUIRE(data_stream.is_open());
+  REQUIRE(op_stream.is_open());
+  std::string const data((std::istreambuf_iterator<char>(data_stream)),
+                         std::istreambuf_iterator<char>());
+  std::string const ops((std::istreambuf_iterator<char>(op_stream)),
+                        std::istreambuf_iterator<char>());
+
+  auto &stats = XML::Stats::instance();
+  stats.reset();
+  std::ostringstream output;
+  Operation::eval(std::string_view(data), ops, output);
+
+  REQUIRE(stats.count(XML::Stats::bytes_read) == data.size() + ops.size());
+  REQUIRE(stats.count(XML::Stats::tokens) > 0);
+  // only the operations document is built, the data is streamed and the
+  // results are written directly
+  REQUIRE(stats.count(XML::Stats::elements) == 5);
+  // 4 distinct filters for every one of the 17 data elements
+  REQUIRE(stats.count(XML::Stats::filter_evaluations) == 4 * 17);
+  REQUIRE(stats.count(XML::Stats::arena_blocks) >= 2);
+  REQUIRE(stats.time(XML::Stats::lex).count() > 0);
+  REQUIRE(stats.time(XML::Stats::output).count() > 0);
+
+  auto const matches = stats.matches();
+  REQUIRE(matches.size() == 4);
+  REQUIRE(matches[0].first == "important");
+  REQUIRE(matches[0].second == 3);
+  std::uint64_t converted = 0;
+  for (auto const &match : matches)
+    converted += match.second;
+  // operations reading the same value of an element share its conversion
+  REQUIRE(stats.count(XML::Stats::conversions) > 0);
+  REQUIRE(stats.count(XML::Stats::conversions) < converted);
+
+  std::ostringstream summary;
+  stats.write_summary(summary, std::chrono::nanoseconds(1000));
+  REQUIRE(summary.str().find("filter_evaluations") != std::string::npos);
+  std::ostringstream json;
+  stats.write_json(json, std::chrono::nanoseconds(1000));
+  REQUIRE(json.str().find("\"important\": 3") != std::string::npos);
+  REQUIRE(json.str().find("\"total\": 1000") != std::string::npos);
+
+  // the stream lexer counts the chars it consumed
+  stats.reset();
+  std::istringstream stream(data);
+  XML::Lexer(stream).tokenize();
+  REQUIRE(stats.count(XML::Stats::bytes_read) == data.size());
+
+  // the chunks of a parallel parse and the prefix up to the first child
+  // are counted once
+  stats.reset();
+  XML::ThreadPool pool(4);
+  XML::parse_parallel(data, pool, 100);
+  REQUIRE(stats.count(XML::Stats::bytes_read) == data.size());
+}